@@ -4,6 +4,11 @@ set(PROJECT_SOURCE_FILES
     "${PROJECT_SRC_DIR}/configuration.cpp"
     "${PROJECT_SRC_DIR}/messages/event.cpp"
     "${PROJECT_SRC_DIR}/messages/detectorlog.cpp"
+    "${PROJECT_SRC_DIR}/messages/binaryevent.cpp"
+    "${PROJECT_SRC_DIR}/messages/serialisation.cpp"
+    "${PROJECT_SRC_DIR}/messages/archiverecord.cpp"
+    "${PROJECT_SRC_DIR}/messages/columnar.cpp"
+    "${PROJECT_SRC_DIR}/messages/histogramepoch.cpp"
     "${PROJECT_SRC_DIR}/analysis/simplecoincidence.cpp"
     "${PROJECT_SRC_DIR}/analysis/coincidence.cpp"
     "${PROJECT_SRC_DIR}/analysis/criterion.cpp"
@@ -11,18 +16,45 @@ set(PROJECT_SOURCE_FILES
     "${PROJECT_SRC_DIR}/analysis/coincidencefilter.cpp"
     "${PROJECT_SRC_DIR}/analysis/detectorstation.cpp"
     "${PROJECT_SRC_DIR}/analysis/stationcoincidence.cpp"
+    "${PROJECT_SRC_DIR}/analysis/histogramstore.cpp"
     "${PROJECT_SRC_DIR}/supervision/state.cpp"
     "${PROJECT_SRC_DIR}/supervision/timebase.cpp"
-    "${PROJECT_SRC_DIR}/supervision/station.cpp")
+    "${PROJECT_SRC_DIR}/supervision/station.cpp"
+    "${PROJECT_SRC_DIR}/source/decodepool.cpp"
+    "${PROJECT_SRC_DIR}/link/influxbatch.cpp"
+    "${PROJECT_SRC_DIR}/link/archive.cpp"
+    "${PROJECT_SRC_DIR}/link/columnararchive.cpp"
+    "${PROJECT_SRC_DIR}/link/sharedring.cpp")
 
 set(PROJECT_HEADER_FILES
     "${PROJECT_HEADER_DIR}/application.h"
     "${PROJECT_HEADER_DIR}/sink/database.h"
     "${PROJECT_HEADER_DIR}/sink/mqtt.h"
     "${PROJECT_HEADER_DIR}/sink/ascii.h"
+    "${PROJECT_HEADER_DIR}/sink/archive.h"
+    "${PROJECT_HEADER_DIR}/sink/columnar.h"
+    "${PROJECT_HEADER_DIR}/sink/sharedmemory.h"
     "${PROJECT_HEADER_DIR}/source/mqtt.h"
+    "${PROJECT_HEADER_DIR}/source/decodepool.h"
+    "${PROJECT_HEADER_DIR}/source/statistics.h"
+    "${PROJECT_HEADER_DIR}/utility/hashtable.h"
+    "${PROJECT_HEADER_DIR}/utility/binarystream.h"
+    "${PROJECT_HEADER_DIR}/utility/textbuffer.h"
+    "${PROJECT_HEADER_DIR}/link/influxbatch.h"
+    "${PROJECT_HEADER_DIR}/link/archive.h"
+    "${PROJECT_HEADER_DIR}/link/columnararchive.h"
+    "${PROJECT_HEADER_DIR}/link/sharedring.h"
+    "${PROJECT_HEADER_DIR}/link/sharedringreader.h"
+    "${PROJECT_HEADER_DIR}/link/statistics.h"
     "${PROJECT_HEADER_DIR}/messages/event.h"
+    "${PROJECT_HEADER_DIR}/messages/binaryevent.h"
+    "${PROJECT_HEADER_DIR}/messages/serialisation.h"
+    "${PROJECT_HEADER_DIR}/messages/archiverecord.h"
+    "${PROJECT_HEADER_DIR}/messages/columnar.h"
+    "${PROJECT_HEADER_DIR}/messages/histogramepoch.h"
+    "${PROJECT_HEADER_DIR}/messages/sharedrecord.h"
     "${PROJECT_HEADER_DIR}/messages/detectorlog.h"
+    "${PROJECT_HEADER_DIR}/messages/logkeys.h"
     "${PROJECT_HEADER_DIR}/messages/detectorinfo.h"
     "${PROJECT_HEADER_DIR}/messages/detectorsummary.h"
     "${PROJECT_HEADER_DIR}/messages/clusterlog.h"
@@ -36,6 +68,7 @@ set(PROJECT_HEADER_FILES
     "${PROJECT_HEADER_DIR}/analysis/coincidencefilter.h"
     "${PROJECT_HEADER_DIR}/analysis/detectorstation.h"
     "${PROJECT_HEADER_DIR}/analysis/stationcoincidence.h"
+    "${PROJECT_HEADER_DIR}/analysis/histogramstore.h"
     "${PROJECT_HEADER_DIR}/supervision/state.h"
     "${PROJECT_HEADER_DIR}/supervision/timebase.h"
     "${PROJECT_HEADER_DIR}/supervision/station.h")
@@ -29,6 +29,7 @@ struct Interval {
     std::chrono::steady_clock::duration clusterlog {};
     std::chrono::steady_clock::duration detectorsummary {};
     std::chrono::system_clock::duration histogram_sample_time {};
+    std::chrono::steady_clock::duration state {};
 };
 
 struct Mqtt {
@@ -47,6 +48,32 @@ struct Influx {
         std::string password {};
     } login;
     std::string database {};
+    int batch_size {};
+    std::chrono::milliseconds batch_interval {};
+    bool gzip {};
+    int queue_size {};
+};
+
+struct Archive {
+    int file_size {};
+    std::chrono::minutes file_age {};
+    int buffer_size {};
+    std::chrono::milliseconds sync_interval {};
+};
+
+struct Columnar {
+    int block_size {};
+    std::chrono::seconds flush_interval {};
+};
+
+struct SharedMemory {
+    int slots {};
+};
+
+struct Histogram {
+    bool text_format {};
+    bool compress {};
+    int capacity {};
 };
 
 struct Trigger {
@@ -55,6 +82,15 @@ struct Trigger {
 struct ConfigFiles {
     std::string config {};
     std::string state {};
+    std::string checkpoint {};
+    std::string spill {};
+};
+
+struct Source {
+    int buffer_size {};
+    std::chrono::seconds buffer_timeout {};
+    int decode_workers {};
+    int identity_cache {};
 };
 
 struct Meta {
@@ -65,13 +101,18 @@ struct Meta {
 };
 
 namespace Default {
-static const ConfigFiles files {"/etc/muondetector/detector-network-processor.cfg", "/var/muondetector/detector-network-processor.state"};
+static const ConfigFiles files {"/etc/muondetector/detector-network-processor.cfg", "/var/muondetector/detector-network-processor.state", "/var/muondetector/detector-network-processor.checkpoint", "/var/muondetector/detector-network-processor.spill"};
 
 static const Mqtt mqtt{"", 1883, {}};
-static const Influx influx{"", {"", ""}, ""};
+static const Influx influx{"", {"", ""}, "", 5000, std::chrono::milliseconds{1000}, false, 100000};
+static const Archive archive{256, std::chrono::minutes{60}, 1024, std::chrono::milliseconds{1000}};
+static const Columnar columnar{4096, std::chrono::seconds{60}};
+static const SharedMemory shared_memory{65536};
+static const Histogram histogram{false, true, 65536};
 static const Trigger trigger{"/var/muondetector/cluster_trigger"};
-static const Interval interval {std::chrono::seconds{60}, std::chrono::seconds{120}, std::chrono::hours{24}};
+static const Interval interval {std::chrono::seconds{60}, std::chrono::seconds{120}, std::chrono::hours{24}, std::chrono::minutes{5}};
 static const Meta meta {false, 6, "muondetector_cluster", 0};
+static const Source source {4096, std::chrono::seconds{10}, 0, 16384};
 }
 
 [[nodiscard]] auto setup(int argc, const char* argv[]) -> std::optional<config>;
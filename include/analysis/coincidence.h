@@ -21,8 +21,9 @@ public:
      */
     [[nodiscard]] auto compare(const event_t::data_t& first, const event_t::data_t& second) const -> double override;
 
-private:
     constexpr static double s_maximum_distance { 62.31836734693877 * units::kilometer };
+
+private:
     constexpr static double s_maximum_time { s_maximum_distance / consts::c_0 };
     constexpr static double s_minimum_time { 150.0 * units::nanosecond };
 };
@@ -13,6 +13,7 @@
 
 #include <map>
 #include <queue>
+#include <string>
 #include <vector>
 
 namespace muonpi {
@@ -22,12 +23,17 @@ namespace muonpi {
  */
 class coincidence_filter : public sink::threaded<event_t>, public source::base<event_t>, public sink::base<timebase_t> {
 public:
+    struct configuration {
+        std::string checkpoint_file {}; //!< The file to save unfinished coincidences to on shutdown. If empty, they are not saved.
+    };
+
     /**
      * @brief coincidence_filter
      * @param event_sink A collection of event sinks to use
      * @param supervisor A reference to a state_supervisor, which keeps track of program metadata
+     * @param config The configuration to use
      */
-    coincidence_filter(sink::base<event_t>& event_sink, supervision::state& supervisor);
+    coincidence_filter(sink::base<event_t>& event_sink, supervision::state& supervisor, configuration config);
 
     ~coincidence_filter() override = default;
 
@@ -43,6 +49,13 @@ public:
      */
     void get(event_t event) override;
 
+    /**
+     * @brief save_checkpoint Writes all unfinished coincidences to the checkpoint file.
+     * Must only be called after the filter thread has stopped.
+     * @return true if the checkpoint was written successfully
+     */
+    auto save_checkpoint() -> bool;
+
 protected:
     /**
      * @brief process Called from step(). Handles a new event arriving
@@ -57,6 +70,12 @@ protected:
     [[nodiscard]] auto process() -> int override;
 
 private:
+    /**
+     * @brief restore_checkpoint Reads the unfinished coincidences from the checkpoint file and puts them in front of the current ones.
+     * The time the constructors have been waiting before the shutdown is preserved, the downtime is not counted.
+     */
+    void restore_checkpoint();
+
     [[nodiscard]] auto next_match(const event_t& event, std::list<event_constructor>::iterator start) -> std::pair<criterion::score_t, std::list<event_constructor>::iterator>;
 
     std::unique_ptr<criterion> m_criterion { std::make_unique<coincidence>() };
@@ -66,6 +85,14 @@ private:
     std::chrono::system_clock::duration m_timeout { std::chrono::seconds { 10 } };
 
     supervision::state& m_supervisor;
+
+    configuration m_config {};
+
+    bool m_restore_pending { true };
+
+    static constexpr std::uint32_t s_checkpoint_magic { 0x4643504D }; //!< "MPCF"
+    static constexpr std::uint16_t s_checkpoint_version { 1 };
+    static constexpr std::uint32_t s_max_checkpoint_size { 1U << 20U };
 };
 
 }
@@ -6,14 +6,17 @@
 #include "messages/detectorstatus.h"
 #include "messages/detectorsummary.h"
 #include "messages/userinfo.h"
+#include "utility/binarystream.h"
 
 #include <muonpi/analysis/dataseries.h>
 #include <muonpi/analysis/ratemeasurement.h>
 #include <muonpi/threadrunner.h>
 
+#include <array>
 #include <chrono>
 #include <future>
 #include <memory>
+#include <optional>
 
 namespace muonpi {
 
@@ -32,7 +35,8 @@ namespace supervision {
 class detector_station {
 public:
     /**
-     * @brief enable Enable the detector_station object so it has the status Enabled
+     * @brief enable Enable the detector_station object so it has its initial status.
+     * This is Created for new detectors and the saved status for restored ones.
      */
     void enable();
 
@@ -69,9 +73,11 @@ public:
     [[nodiscard]] auto factor() const -> double;
 
     /**
-     * @brief step Gets called by the supervision::station with a guaranteed maximum time delay. May be called more often.
+     * @brief step Gets called by the supervision::station at the latest at the time point it returned the last time. May be called more often.
+     * @param now The current time
+     * @return The time point at which the next status transition or rate window is due. It is always later than now.
      */
-    void step(const std::chrono::system_clock::time_point& now);
+    [[nodiscard]] auto step(const std::chrono::system_clock::time_point& now) -> std::chrono::system_clock::time_point;
 
     /**
      * @brief current_log_data gets the current log data.
@@ -97,6 +103,26 @@ public:
      */
     [[nodiscard]] auto location() const -> location_t;
 
+    /**
+     * @brief hash Accesses the hashed identifier of the detector
+     * @return the hash
+     */
+    [[nodiscard]] auto hash() const -> std::size_t;
+
+    /**
+     * @brief save Writes the persistent state of this detector, so it can be restored after a restart
+     * @param out The writer to use
+     */
+    void save(binary::writer& out) const;
+
+    /**
+     * @brief restore Creates a detector from a state written by save
+     * @param in The reader to use
+     * @param stationsupervisor The station supervisor the detector belongs to
+     * @return The detector, std::nullopt if the state could not be read
+     */
+    [[nodiscard]] static auto restore(binary::reader& in, supervision::station& stationsupervisor) -> std::optional<detector_station>;
+
 protected:
     /**
      * @brief set_status Sets the status of this detector and sends the status to the listener if it has changed.
@@ -110,33 +136,76 @@ private:
      */
     void check_reliability();
 
-    detector_status::status m_status { detector_status::unreliable };
+    /**
+     * @brief update_location Sets a new location of the detector. The geohash is only recalculated if the detector has moved.
+     * @param location The new location
+     */
+    void update_location(location_t location);
 
-    bool m_initial { true };
+    /**
+     * @brief reliability_time_acc The mean of the most recent time accuracy values, used as reliability measure
+     */
+    [[nodiscard]] auto reliability_time_acc() const -> double;
+
+    /**
+     * @brief time_acc_band The position of the reliability time accuracy relative to the hysteresis band
+     * @return -1 below the band, 0 within the band, 1 above the band
+     */
+    [[nodiscard]] auto time_acc_band() const -> std::int8_t;
+
+    static constexpr std::size_t s_reliability_time_acc_length { 5 };
+    static constexpr double s_reliability_hysteresis { 0.15 };
+
+    /**
+     * @brief The fields which are touched for every single event.
+     * They are kept together and free of heap allocations, so processing an event stays within few cache lines.
+     */
+    struct hot_state {
+        std::uint64_t incoming { 0 };
+        std::int64_t ublox_counter_progress { 0 };
+        double time_acc_sum { 0.0 }; //< sum of time accuracy values provided by event messages since the last summary (in ns)
+        double pulselength_sum { 0.0 };
+        std::uint32_t time_acc_n { 0 };
+        std::uint32_t pulselength_n { 0 };
+        std::array<double, s_reliability_time_acc_length> reliability_time_acc {}; //< ring buffer for time accuracy for use as reliability measure
+        std::uint8_t reliability_time_acc_next { 0 };
+        std::uint8_t reliability_time_acc_n { 0 };
+        std::int8_t time_acc_band { 0 }; //< hysteresis band of the time accuracy at the last reliability check
+        std::uint16_t last_ublox_counter { 0 };
+        bool initial { true };
+        std::uint32_t window_events { 0 }; //< number of events in the current rate window
+    } m_hot {};
+
+    detector_status::status m_status { detector_status::unreliable };
+    detector_status::status m_initial_status { detector_status::created };
 
     location_t m_location {};
     std::size_t m_hash { 0 };
     userinfo_t m_userinfo {};
 
     std::chrono::system_clock::time_point m_last_log { std::chrono::system_clock::now() };
+    bool m_log_missing { false };
 
     static constexpr std::chrono::seconds s_log_interval { 90 };
     static constexpr auto s_offline_interval { s_log_interval * 3 };
     static constexpr std::chrono::hours s_quit_interval { 48 };
     static constexpr std::size_t s_history_length { 10 };
     static constexpr std::chrono::seconds s_time_interval { 30 };
+    static constexpr std::chrono::milliseconds s_step_resolution { 100 };
 
-    supervision::station& m_stationsupervisor;
+    supervision::station* m_stationsupervisor { nullptr };
 
     rate_measurement<double> m_current_rate { s_history_length, s_time_interval };
     rate_measurement<double> m_mean_rate { s_history_length, s_time_interval };
+    std::chrono::system_clock::time_point m_next_rate_step { m_last_log + s_time_interval };
 
-    detector_summary_t m_current_data;
-    std::uint16_t m_last_ublox_counter {};
+    // copy of the rate history, which is not accessible from the rate measurement itself
+    std::array<double, s_history_length> m_rate_history {};
+    std::uint8_t m_rate_history_next { 0 };
+    std::uint8_t m_rate_history_n { 0 };
+    std::chrono::system_clock::time_point m_rate_window_start { m_last_log };
 
-    data_series<double> m_pulselength { 100 };
-    data_series<double> m_time_acc { 100 }; //< ring buffer for time accuracy values provided by event messages (in ns)
-    data_series<double> m_reliability_time_acc { 5 }; //< ring buffer for time accuracy for use as reliability measure
+    detector_summary_t m_current_data;
 
     double m_factor { 1.0 };
 };
@@ -33,6 +33,19 @@ public:
      */
     [[nodiscard]] auto timed_out(std::chrono::system_clock::time_point now) const -> bool;
 
+    /**
+     * @brief elapsed The time since the constructor was started
+     * @param now The current time
+     */
+    [[nodiscard]] auto elapsed(std::chrono::system_clock::time_point now) const -> std::chrono::system_clock::duration;
+
+    /**
+     * @brief rebase Moves the start of the constructor, so the given time has elapsed at the current time. Used to continue a restored constructor.
+     * @param now The current time
+     * @param elapsed The time which should have elapsed
+     */
+    void rebase(std::chrono::system_clock::time_point now, std::chrono::system_clock::duration elapsed);
+
     event_t event;
     std::chrono::system_clock::duration timeout { std::chrono::minutes { 1 } };
 
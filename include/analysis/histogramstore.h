@@ -0,0 +1,212 @@
+#ifndef HISTOGRAMSTORE_H
+#define HISTOGRAMSTORE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+
+namespace muonpi {
+
+/**
+ * @brief The histogram_store class
+ * Stores the counts of the station pair histograms in a memory mapped file, so they survive a restart of the processor.
+ * Each slot describes one station pair and holds two sets of counts. One of them is filled, the other one holds the previous sample while it is saved.
+ * Next to the counts, each slot keeps the uptime of its pair, so the rates of a resumed sample stay consistent with its counts.
+ * The file is created with its full capacity as a sparse file, so only slots which are used occupy memory and disk space and the mapping never moves.
+ * Released slots are kept in a free list and reused by the next allocation.
+ * If the file can not be mapped, the counts are kept in anonymous memory instead.
+ *
+ * When an existing file is resumed, the histograms which are not filled are cleared, they might still hold a sample whose save was interrupted.
+ */
+class histogram_store {
+public:
+    struct slot_header {
+        std::uint64_t first { 0 }; //!< The smaller hash of both stations
+        std::uint64_t second { 0 }; //!< The larger hash of both stations
+        float distance { 0.0F };
+        std::int32_t bin_width { 0 };
+        std::uint64_t total[2] {};
+        std::int64_t last_online { 0 }; //!< The time since which both stations are online in s since epoch
+        std::int32_t uptime { 0 }; //!< The time both stations were online during the current sample until last_online in min
+        std::uint8_t online { 0 }; //!< The number of reliable stations of the pair
+        std::uint8_t used { 0 }; //!< 1 if the slot is assigned to a pair, 0 if it is free
+        std::uint16_t reserved { 0 };
+        std::uint64_t next_free { 0 }; //!< The next free slot + 1 while the slot is free, 0 for the end of the list
+    };
+
+    constexpr static std::size_t s_invalid { std::numeric_limits<std::size_t>::max() };
+
+    /**
+     * @brief histogram_store Maps the file, an existing file with the same number of bins is resumed
+     * @param path The path of the file
+     * @param bins The number of bins per histogram
+     * @param capacity The maximum number of pairs
+     */
+    histogram_store(std::string path, std::size_t bins, std::size_t capacity);
+
+    ~histogram_store();
+
+    histogram_store(const histogram_store&) = delete;
+    histogram_store(histogram_store&&) = delete;
+    auto operator=(const histogram_store&) -> histogram_store& = delete;
+    auto operator=(histogram_store&&) -> histogram_store& = delete;
+
+    /**
+     * @brief allocate Assigns a slot to a station pair
+     * @param first The hash of one station
+     * @param second The hash of the other station
+     * @param distance The distance of the stations in m
+     * @param bin_width The bin width of the histograms in ns
+     * @return The slot, s_invalid if the store is full
+     */
+    [[nodiscard]] auto allocate(std::uint64_t first, std::uint64_t second, float distance, std::int32_t bin_width) -> std::size_t;
+
+    /**
+     * @brief release Clears a slot and gives it back to the free list
+     */
+    void release(std::size_t slot);
+
+    /**
+     * @brief used Checks whether a slot is assigned to a pair
+     */
+    [[nodiscard]] auto used(std::size_t slot) const -> bool;
+
+    /**
+     * @brief add Adds a value to a histogram
+     * @param slot The slot of the pair
+     * @param set Which of the two histograms of the pair to fill
+     * @param value The value in ns
+     */
+    void add(std::size_t slot, std::size_t set, std::int32_t value);
+
+    /**
+     * @brief clear Sets all counts of a histogram to zero
+     */
+    void clear(std::size_t slot, std::size_t set);
+
+    [[nodiscard]] auto header(std::size_t slot) const -> const slot_header&;
+
+    /**
+     * @brief set_uptime Stores the uptime of a pair
+     * @param slot The slot of the pair
+     * @param online The number of reliable stations of the pair
+     * @param uptime The uptime during the current sample until last_online in min
+     * @param last_online The time since which both stations are online in s since epoch
+     */
+    void set_uptime(std::size_t slot, std::uint8_t online, std::int32_t uptime, std::int64_t last_online);
+
+    /**
+     * @brief counts The counts of all bins of a histogram
+     */
+    [[nodiscard]] auto counts(std::size_t slot, std::size_t set) const -> const std::uint32_t*;
+
+    /**
+     * @brief active Which of the two histograms of each pair is filled
+     */
+    [[nodiscard]] auto active() const -> std::size_t;
+
+    void set_active(std::size_t set);
+
+    /**
+     * @brief sample_start The start of the current sample in s since epoch, 0 for a new store
+     */
+    [[nodiscard]] auto sample_start() const -> std::int64_t;
+
+    void set_sample_start(std::int64_t start);
+
+    /**
+     * @brief updated The last time counts were added or the uptime was brought up to date in s since epoch
+     */
+    [[nodiscard]] auto updated() const -> std::int64_t;
+
+    void set_updated(std::int64_t time);
+
+    /**
+     * @brief size The number of slots in use
+     */
+    [[nodiscard]] auto size() const -> std::size_t;
+
+    /**
+     * @brief slots The number of slots which were ever allocated, in use or free. All used slots are below this number.
+     */
+    [[nodiscard]] auto slots() const -> std::size_t;
+
+    [[nodiscard]] auto capacity() const -> std::size_t;
+
+    /**
+     * @brief persistent Checks whether the store is backed by its file
+     */
+    [[nodiscard]] auto persistent() const -> bool;
+
+    /**
+     * @brief sync Writes all modified pages to the file
+     */
+    void sync();
+
+private:
+    struct file_header {
+        std::uint32_t magic { 0 };
+        std::uint16_t version { 0 };
+        std::uint16_t reserved { 0 };
+        std::uint32_t bins { 0 };
+        std::uint32_t active { 0 };
+        std::uint64_t capacity { 0 };
+        std::uint64_t slots { 0 };
+        std::int64_t sample_start { 0 };
+        std::int64_t updated { 0 };
+        std::uint64_t free { 0 }; //!< The number of free slots
+        std::uint64_t free_head { 0 }; //!< The first free slot + 1, 0 if there is none
+    };
+
+    constexpr static std::uint32_t s_magic { 0x5348504D }; // "MPHS"
+    constexpr static std::uint16_t s_version { 2 };
+    constexpr static std::size_t s_alignment { 64 };
+
+    [[nodiscard]] auto slot_at(std::size_t slot) const -> std::byte*;
+
+    void map_anonymous();
+
+    /**
+     * @brief recover Clears the histograms which are not filled and rebuilds the free list of a resumed store
+     */
+    void recover();
+
+    std::string m_path {};
+    std::size_t m_bins { 0 };
+    std::size_t m_stride { 0 };
+    std::size_t m_size { 0 };
+    bool m_persistent { false };
+
+    file_header* m_header { nullptr };
+    std::byte* m_slots { nullptr };
+};
+
+// +++++++++++++++++++++++++++++++
+// implementation part starts here
+// +++++++++++++++++++++++++++++++
+
+inline auto histogram_store::slot_at(std::size_t slot) const -> std::byte*
+{
+    return m_slots + slot * m_stride;
+}
+
+inline void histogram_store::add(std::size_t slot, std::size_t set, std::int32_t value)
+{
+    auto* slot_data { slot_at(slot) };
+    const auto& h { *reinterpret_cast<const slot_header*>(slot_data) };
+    const std::int64_t offset { static_cast<std::int64_t>(value) + static_cast<std::int64_t>(h.bin_width) * static_cast<std::int64_t>(m_bins / 2) };
+    if ((offset < 0) || (h.bin_width <= 0)) {
+        return;
+    }
+    const auto bin { static_cast<std::size_t>(offset / h.bin_width) };
+    if (bin >= m_bins) {
+        return;
+    }
+    reinterpret_cast<std::uint32_t*>(slot_data + s_alignment)[set * m_bins + bin]++;
+    reinterpret_cast<slot_header*>(slot_data)->total[set]++;
+}
+
+} // namespace muonpi
+
+#endif // HISTOGRAMSTORE_H
@@ -1,6 +1,8 @@
 ﻿#ifndef STATION_COINCIDENCE_H
 #define STATION_COINCIDENCE_H
 
+#include "analysis/coincidence.h"
+#include "analysis/histogramstore.h"
 #include "messages/event.h"
 #include "messages/trigger.h"
 
@@ -9,10 +11,13 @@
 
 #include <muonpi/sink/base.h>
 
-#include <muonpi/analysis/histogram.h>
 #include <muonpi/analysis/uppermatrix.h>
 
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 
 namespace muonpi {
 
@@ -21,12 +26,18 @@ namespace supervision {
 }
 
 /**
- * @brief The station_coincidence class. It stores histograms between all possible detector pairs.
+ * @brief The station_coincidence class. It stores histograms between all detector pairs which are close enough to see coincidences.
+ * The histograms of a pair are only allocated once the first coincidence between both detectors occurs,
+ * and released again once a pair had no coincidence during a whole sample.
+ * They are kept in a histogram_store in the data directory together with the uptime of the pair, so the current sample is continued after a restart.
  */
 class station_coincidence : public sink::base<event_t>, public sink::base<trigger::detector>, public thread_runner {
 public:
     struct configuration {
         std::chrono::system_clock::duration histogram_sample_time {};
+        bool text_format { false }; //!< Write one text file per pair instead of one binary file per sample
+        bool compress { true }; //!< Compress the histograms in the binary files
+        std::size_t capacity {}; //!< The maximum number of pairs with histograms
     };
     /**
      * @brief station_coincidence
@@ -57,27 +68,80 @@ private:
     void reset();
     void add_station(const userinfo_t& userinfo, const location_t& location);
 
+    struct data_t;
+    struct sample_t;
+
+    /**
+     * @brief save_binary Writes a sample as one epoch file, @see messages/histogramepoch.h
+     */
+    void save_binary(const std::string& filename, std::chrono::system_clock::time_point start, std::chrono::system_clock::time_point end, const std::vector<std::pair<userinfo_t, location_t>>& stations, const std::vector<sample_t>& samples);
+
+    /**
+     * @brief save_text Writes a sample as a directory with a histogram and a meta data file per pair, an adjacency matrix and a station list
+     */
+    void save_text(const std::string& filename, std::chrono::system_clock::duration duration, const std::vector<std::pair<userinfo_t, location_t>>& current_stations, const std::vector<sample_t>& samples);
+
+    /**
+     * @brief allocate Assigns a slot of the histogram store to a pair, reusing the slot of a previous run if there is one
+     * @param pair The pair to allocate the histograms for
+     */
+    void allocate(data_t& pair);
+
+    /**
+     * @brief store_uptime Copies the uptime of a pair to its slot in the histogram store
+     */
+    void store_uptime(const data_t& pair);
+
+    /**
+     * @brief index_of Finds the position of a station, adding it if it is not known yet
+     * @param hash The hash of the station
+     */
+    [[nodiscard]] auto index_of(std::size_t hash) -> std::size_t;
+
     supervision::station& m_stationsupervisor;
 
     std::string m_data_directory {};
 
     constexpr static std::size_t s_bins { 2000 }; //<! total number of bins to use per pair
     constexpr static double s_total_width { 2.0 * 100000.0 };
+    constexpr static double s_maximum_distance { coincidence::s_maximum_distance }; //<! pairs further apart get no histograms
+    constexpr static std::size_t s_unallocated { histogram_store::s_invalid };
 
-    std::atomic<bool> m_saving { false };
-
-    using histogram_t = histogram<std::int32_t, std::uint32_t>;
     struct data_t {
         std::size_t first {};
         std::size_t second {};
         float distance {};
-        histogram_t hist { s_bins };
+        std::int32_t bin_width {};
+        std::size_t histograms { s_unallocated }; //<! slot of this pair in the histogram store
         std::uint8_t online { 2 };
         std::chrono::system_clock::time_point last_online { std::chrono::system_clock::now() };
         std::int32_t uptime { 0 };
     };
     std::vector<std::pair<userinfo_t, location_t>> m_stations {};
+    std::unordered_map<std::size_t, std::size_t> m_index {}; //<! maps the hash of a station to its position in m_stations
+    std::vector<std::size_t> m_event_indices {};
     upper_matrix<data_t> m_data {};
+
+    /**
+     * Each pair has two histograms. One of them is filled, the other one holds the previous sample while it is saved.
+     * The store never moves its memory, so the counts taken for saving stay valid while new pairs are allocated.
+     */
+    std::unique_ptr<histogram_store> m_store { nullptr };
+    std::map<std::pair<std::uint64_t, std::uint64_t>, std::size_t> m_detached {}; //<! slots of a previous run whose stations are not known yet, released with the next save
+    bool m_store_full { false };
+
+    struct sample_t {
+        std::size_t first {};
+        std::size_t second {};
+        float distance {};
+        std::int32_t bin_width {};
+        std::int32_t uptime {};
+        std::size_t slot { s_unallocated };
+        const std::uint32_t* counts { nullptr }; //<! nullptr if no coincidence occured yet
+        std::uint64_t total { 0 };
+    };
+
+    std::mutex m_mutex {}; //<! guards the stations, the pair data and the active histogram index
     std::chrono::system_clock::time_point m_last_save { std::chrono::system_clock::now() };
 
     configuration m_config {};
@@ -0,0 +1,134 @@
+#ifndef ARCHIVE_H
+#define ARCHIVE_H
+
+#include <muonpi/threadrunner.h>
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace muonpi::link {
+
+/**
+ * @brief The archive class
+ * Writes records to local files, which are rotated once they reach a maximum size or age.
+ * Appending a record only copies it into a memory buffer. The buffer is written by the thread of the archive in large writes,
+ * once it is full or the sync interval has passed. The data is synced to disk at most once per sync interval, for all records written in the meantime.
+ *
+ * Each file is listed in an index file together with the range of record timestamps it contains,
+ * so the files which cover a time range can be found without reading them.
+ * A file is listed with an open end as soon as records are written to it, and listed again with its final range once it is closed.
+ * So the file which was written during a crash can still be found.
+ */
+class archive : public thread_runner {
+public:
+    struct configuration {
+        std::string directory {}; //!< The directory the files are written to
+        std::string prefix {}; //!< The prefix of the file names, also used for the name of the index file
+        std::size_t max_file_size {}; //!< The size in bytes after which a new file is started
+        std::chrono::system_clock::duration max_file_age {}; //!< The time after which a new file is started
+        std::size_t buffer_size {}; //!< The size of the buffer in bytes which triggers a write
+        std::chrono::steady_clock::duration sync_interval {}; //!< The maximum time between writing a record and syncing it to disk
+    };
+
+    /**
+     * @brief The index_entry struct
+     * Describes one file of the archive.
+     */
+    struct index_entry {
+        std::string file {};
+        std::int_fast64_t first {}; //!< The smallest record timestamp in the file
+        std::int_fast64_t last {}; //!< The largest record timestamp in the file, the maximum value while the file was not closed
+        std::size_t records { 0 };
+    };
+
+    /**
+     * @brief archive
+     * @param config The configuration to use
+     */
+    explicit archive(configuration config);
+
+    /**
+     * @brief append Adds a record to the archive
+     * @param timestamp The timestamp of the record, used for the index
+     * @param record The complete record, including the line break
+     */
+    void append(std::int_fast64_t timestamp, std::string_view record);
+
+    /**
+     * @brief index_file The path of the index file of this archive
+     */
+    [[nodiscard]] auto index_file() const -> std::string;
+
+    /**
+     * @brief find Searches an index file for the files which contain records from a time range
+     * @param index_file The path of the index file
+     * @param from The start of the time range
+     * @param to The end of the time range
+     * @return The entries of all files which overlap the time range, in the order they were written
+     */
+    [[nodiscard]] static auto find(const std::string& index_file, std::int_fast64_t from, std::int_fast64_t to) -> std::vector<index_entry>;
+
+protected:
+    [[nodiscard]] auto step() -> int override;
+
+    [[nodiscard]] auto post_run() -> int override;
+
+private:
+    struct batch {
+        std::string data {};
+        std::size_t records { 0 };
+        std::int_fast64_t first {};
+        std::int_fast64_t last {};
+    };
+
+    /**
+     * @brief write Writes the collected records to the current file, rotates and syncs it if necessary
+     * @param force_sync Sync the file regardless of the sync interval
+     */
+    void write(bool force_sync);
+
+    /**
+     * @brief open Starts a new file
+     * @return true if the file could be opened
+     */
+    [[nodiscard]] auto open() -> bool;
+
+    /**
+     * @brief close Syncs and closes the current file and adds its final range to the index
+     */
+    void close();
+
+    /**
+     * @brief add_to_index Appends an entry for the current file to the index
+     * @param last The largest record timestamp to list for the file
+     */
+    void add_to_index(std::int_fast64_t last);
+
+    /**
+     * @brief sync Syncs the current file to disk, if anything was written since the last sync
+     */
+    void sync();
+
+    configuration m_config {};
+
+    std::mutex m_mutex {};
+    batch m_collecting {};
+
+    // only accessed by the thread of the archive
+    batch m_writing {};
+    int m_fd { -1 };
+    index_entry m_current {};
+    std::size_t m_file_size { 0 };
+    std::chrono::system_clock::time_point m_file_opened {};
+    std::chrono::steady_clock::time_point m_last_sync { std::chrono::steady_clock::now() };
+    bool m_unsynced { false };
+    bool m_failed { false };
+};
+
+} // namespace muonpi::link
+
+#endif // ARCHIVE_H
@@ -0,0 +1,76 @@
+#ifndef COLUMNARARCHIVE_H
+#define COLUMNARARCHIVE_H
+
+#include "messages/event.h"
+
+#include <muonpi/threadrunner.h>
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace muonpi::link {
+
+/**
+ * @brief The columnar_archive class
+ * Writes coincidences to hourly partitioned files in the columnar format described in messages/columnar.h.
+ * Coincidences are collected in memory and encoded by the thread of the archive once a block is full or the flush interval has passed.
+ * Before a file is appended to for the first time, an incomplete block left by a crash is cut off, so the blocks written afterwards stay readable.
+ */
+class columnar_archive : public thread_runner {
+public:
+    struct configuration {
+        std::string directory {}; //!< The directory the files are written to
+        std::size_t block_size {}; //!< The number of coincidences after which a block is written
+        std::chrono::steady_clock::duration flush_interval {}; //!< The maximum time a coincidence waits before it is written
+    };
+
+    /**
+     * @brief columnar_archive
+     * @param config The configuration to use
+     */
+    explicit columnar_archive(configuration config);
+
+    /**
+     * @brief add Adds a coincidence to the archive
+     * @param event The coincidence to add
+     */
+    void add(event_t event);
+
+protected:
+    [[nodiscard]] auto step() -> int override;
+
+    [[nodiscard]] auto post_run() -> int override;
+
+private:
+    constexpr static std::int64_t s_repaired_age { 24LL * 3600LL * 1'000'000'000LL }; //!< In ns
+
+    /**
+     * @brief write Writes the collected coincidences, split into their partitions
+     */
+    void write();
+
+    /**
+     * @brief repair Cuts off an incomplete block at the end of a partition file, once per partition and run
+     * @param partition_start The start of the partition
+     * @param path The path of the file of the partition
+     */
+    void repair(std::int64_t partition_start, const std::filesystem::path& path);
+
+    configuration m_config {};
+
+    std::mutex m_mutex {};
+    std::vector<event_t> m_collecting {};
+
+    // only accessed by the thread of the archive
+    std::vector<event_t> m_writing {};
+    std::set<std::int64_t> m_repaired {};
+};
+
+} // namespace muonpi::link
+
+#endif // COLUMNARARCHIVE_H
@@ -0,0 +1,250 @@
+#ifndef INFLUXBATCH_H
+#define INFLUXBATCH_H
+
+#include "link/statistics.h"
+#include "utility/textbuffer.h"
+
+#include <muonpi/threadrunner.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <ios>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace muonpi::link {
+
+/**
+ * @brief The influx_batch class
+ * Writes InfluxDB line protocol records. Instead of sending each record on its own,
+ * the records are collected and sent in a single HTTP request once the batch is full or the batch interval has passed.
+ * The interface of the entries is the same as the one of link::influx,
+ * except that each record is formatted into a text_buffer owned by the caller, so writing a record allocates no memory.
+ *
+ * Writing never blocks the caller. Batches which could not be sent are kept in memory up to the queue size,
+ * further batches are appended to the spill file. Once the database accepts writes again,
+ * the queued batches are sent first, followed by the content of the spill file, so the order is preserved.
+ */
+class influx_batch : public thread_runner {
+public:
+    struct configuration {
+        std::string host {}; //!< Either a plain hostname, which is reached via https, or an url of the form http[s]://host[:port]
+        struct Login {
+            std::string username {};
+            std::string password {};
+        } login;
+        std::string database {};
+        std::size_t batch_size {}; //!< The number of records after which a batch is sent
+        std::chrono::steady_clock::duration batch_interval {}; //!< The maximum time a record waits before it is sent
+        bool gzip {}; //!< Compress the request body
+        std::size_t queue_size {}; //!< The maximum number of unsent records kept in memory
+        std::string spill_file {}; //!< The file to append unsent records to once the queue is full. If empty, they are dropped.
+    };
+
+    struct tag {
+        std::string_view name {};
+        std::string_view value {};
+    };
+
+    template <typename T>
+    struct field {
+        std::string_view name {};
+        T value {};
+    };
+
+    class entry {
+    public:
+        /**
+         * @brief operator<< Adds a tag. Tags have to be added before the first field, later ones are ignored.
+         */
+        auto operator<<(const tag& t) -> entry&;
+
+        template <typename T>
+        auto operator<<(const field<T>& f) -> entry&;
+
+        /**
+         * @brief commit Adds the record to the current batch
+         * @param timestamp The timestamp of the record in ns since epoch
+         * @return false if the record has no fields and can't be written
+         */
+        [[nodiscard]] auto commit(std::int_fast64_t timestamp) -> bool;
+
+    private:
+        friend class influx_batch;
+
+        entry(std::string_view measurement, influx_batch& link, text_buffer& buffer);
+
+        influx_batch* m_link { nullptr };
+        text_buffer* m_buffer { nullptr };
+        bool m_has_fields { false };
+    };
+
+    /**
+     * @brief influx_batch
+     * @param config The configuration to use
+     */
+    explicit influx_batch(configuration config);
+
+    /**
+     * @brief measurement Starts a new record
+     * @param measurement The name of the measurement
+     * @param buffer The buffer the record is formatted in. Its previous content is discarded.
+     * @return The entry to which tags and fields can be added
+     */
+    [[nodiscard]] auto measurement(std::string_view measurement, text_buffer& buffer) -> entry;
+
+    /**
+     * @brief statistics Access the statistics of the unsent records
+     */
+    [[nodiscard]] auto statistics() const -> const queue_statistics&;
+
+protected:
+    [[nodiscard]] auto step() -> int override;
+
+    [[nodiscard]] auto post_run() -> int override;
+
+private:
+    /**
+     * @brief escape Appends a string and escapes the characters which have a special meaning in the line protocol
+     * @param out The buffer to append to
+     * @param value The string to escape
+     * @param characters The characters which need to be escaped
+     */
+    static void escape(text_buffer& out, std::string_view value, const char* characters);
+
+    void append(std::string_view line);
+
+    struct batch {
+        std::string lines {};
+        std::size_t n { 0 };
+    };
+
+    /**
+     * @brief The delivery enum
+     * The outcome of sending a batch. Only batches which failed for a temporary reason are sent again.
+     */
+    enum class delivery {
+        accepted,
+        failed, //!< The database could not be reached, had an internal error or asked to slow down
+        rejected //!< The database refused the batch itself, sending it again would give the same result
+    };
+
+    /**
+     * @brief collect Moves the currently collected records into the queue, or into the spill file if the queue is full
+     */
+    void collect();
+
+    /**
+     * @brief send_pending Sends the queued batches and afterwards the content of the spill file
+     * @return true if nothing is left to send
+     */
+    auto send_pending() -> bool;
+
+    /**
+     * @brief send Sends one batch, compressed if configured
+     */
+    [[nodiscard]] auto send(const batch& records) -> delivery;
+
+    /**
+     * @brief spill Appends a batch to the spill file
+     * @return true if the batch was written
+     */
+    [[nodiscard]] auto spill(const batch& records) -> bool;
+
+    /**
+     * @brief read_spilled Reads the next batch from the spill file
+     * @param records The batch to read to
+     * @return false if there is no further batch
+     */
+    [[nodiscard]] auto read_spilled(batch& records) -> bool;
+
+    /**
+     * @brief store_pending Rewrites the spill file with the queued batches in front of the spilled batches which were not replayed yet
+     * @return true if the file was written
+     */
+    [[nodiscard]] auto store_pending() -> bool;
+
+    /**
+     * @brief recover_spill Checks for a spill file left by an earlier run
+     */
+    void recover_spill();
+
+    /**
+     * @brief post Sends one request body to the database
+     * @param body The body, already compressed if configured
+     */
+    [[nodiscard]] auto post(const std::string& body) -> delivery;
+
+    struct destination {
+        std::string host {};
+        std::string port {};
+        std::string target {};
+        std::string authorization {};
+        bool ssl { true };
+    };
+
+    [[nodiscard]] static auto parse_destination(const configuration& config) -> destination;
+
+    configuration m_config {};
+    destination m_destination {};
+
+    std::mutex m_mutex {};
+    std::string m_buffer {};
+    std::size_t m_lines { 0 };
+
+    // only accessed by the thread of the link
+    std::deque<batch> m_queue {};
+    bool m_spilling { false };
+    std::streamoff m_spill_offset { 0 };
+
+    queue_statistics m_statistics {};
+
+    static constexpr std::uint32_t s_max_batch_length { 1U << 28U };
+
+    static constexpr std::chrono::seconds s_request_timeout { 10 };
+};
+
+// +++++++++++++++++++++++++++++++
+// implementation part starts here
+// +++++++++++++++++++++++++++++++
+
+template <typename T>
+auto influx_batch::entry::operator<<(const field<T>& f) -> entry&
+{
+    if constexpr (std::is_floating_point_v<T>) {
+        if (!std::isfinite(f.value)) {
+            // the line protocol has no representation for nan and inf
+            return *this;
+        }
+    }
+    *m_buffer << (m_has_fields ? ',' : ' ');
+    m_has_fields = true;
+    escape(*m_buffer, f.name, ", =");
+    *m_buffer << '=';
+
+    if constexpr (std::is_same_v<T, std::string> || std::is_same_v<T, std::string_view>) {
+        *m_buffer << '"';
+        escape(*m_buffer, f.value, "\"\\");
+        *m_buffer << '"';
+    } else if constexpr (std::is_same_v<T, bool>) {
+        *m_buffer << (f.value ? "true" : "false");
+    } else if constexpr (std::is_integral_v<T>) {
+        if constexpr (std::is_signed_v<T>) {
+            *m_buffer << static_cast<long long>(f.value) << 'i';
+        } else {
+            *m_buffer << static_cast<unsigned long long>(f.value) << 'i';
+        }
+    } else {
+        static_assert(std::is_floating_point_v<T>, "Unsupported field type");
+        m_buffer->append(static_cast<double>(f.value), text_buffer::s_shortest);
+    }
+    return *this;
+}
+
+} // namespace muonpi::link
+
+#endif // INFLUXBATCH_H
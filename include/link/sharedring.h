@@ -0,0 +1,67 @@
+#ifndef SHAREDRING_H
+#define SHAREDRING_H
+
+#include "messages/sharedrecord.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace muonpi::link {
+
+/**
+ * @brief The shared_ring class
+ * Publishes fixed size records into a POSIX shared memory ring, from which any number of local processes can read with shm::ring_reader.
+ * There must only be one thread publishing to a ring. Publishing never waits for readers,
+ * a reader which falls behind by more than the size of the ring loses the overwritten records.
+ */
+class shared_ring {
+public:
+    struct configuration {
+        std::string name {}; //!< The name of the shared memory object, has to start with a '/'
+        std::size_t slots {}; //!< The number of records the ring holds
+    };
+
+    /**
+     * @brief shared_ring Creates the shared memory object. An existing object of the same name is replaced.
+     * @param config The configuration to use
+     * @param type The type of the records
+     * @param record_size The size of the records
+     */
+    shared_ring(configuration config, shm::record_type type, std::size_t record_size);
+
+    /**
+     * @brief ~shared_ring Marks the ring as closed and removes the shared memory object. Readers which have it mapped can still read the remaining records.
+     */
+    ~shared_ring();
+
+    shared_ring(const shared_ring&) = delete;
+    shared_ring(shared_ring&&) = delete;
+    auto operator=(const shared_ring&) -> shared_ring& = delete;
+    auto operator=(shared_ring&&) -> shared_ring& = delete;
+
+    /**
+     * @brief publish Writes a record to the next slot
+     * @param record The record, has to be of the size given on construction
+     */
+    void publish(const void* record);
+
+    /**
+     * @brief good Checks whether the shared memory could be created
+     */
+    [[nodiscard]] auto good() const -> bool;
+
+private:
+    configuration m_config {};
+    std::size_t m_record_size { 0 };
+    std::size_t m_stride { 0 };
+    std::size_t m_size { 0 };
+
+    shm::ring_header* m_header { nullptr };
+    std::byte* m_slots { nullptr };
+    std::uint64_t m_sequence { 0 };
+};
+
+} // namespace muonpi::link
+
+#endif // SHAREDRING_H
@@ -0,0 +1,193 @@
+#ifndef SHAREDRINGREADER_H
+#define SHAREDRINGREADER_H
+
+#include "messages/sharedrecord.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace muonpi::shm {
+
+template <typename R>
+struct record_traits;
+
+template <>
+struct record_traits<event_record> {
+    static constexpr record_type type { record_type::event };
+};
+
+template <>
+struct record_traits<detector_summary_record> {
+    static constexpr record_type type { record_type::detector_summary };
+};
+
+template <typename R>
+/**
+ * @brief The ring_reader class
+ * Reads the records of a shared memory ring written by link::shared_ring.
+ * This header only depends on the standard library and POSIX, so local consumers can include it without linking to the processor.
+ * Reading never blocks the producer. When the reader falls behind by more than the size of the ring, the overwritten records are skipped and counted as lost.
+ */
+class ring_reader {
+public:
+    /**
+     * @brief ring_reader Maps an existing ring. Reading starts with the next record published.
+     * @param name The name of the shared memory object
+     */
+    explicit ring_reader(const std::string& name);
+
+    ~ring_reader();
+
+    ring_reader(const ring_reader&) = delete;
+    ring_reader(ring_reader&&) = delete;
+    auto operator=(const ring_reader&) -> ring_reader& = delete;
+    auto operator=(ring_reader&&) -> ring_reader& = delete;
+
+    /**
+     * @brief next Reads the next record, if there is one
+     * @param record The record to read to
+     * @return false if no new record is available
+     */
+    [[nodiscard]] auto next(R& record) -> bool;
+
+    /**
+     * @brief good Checks whether the ring could be mapped and has the expected layout
+     */
+    [[nodiscard]] auto good() const -> bool;
+
+    /**
+     * @brief closed Checks whether the producer has stopped. The ring has to be reopened to receive further records.
+     */
+    [[nodiscard]] auto closed() const -> bool;
+
+    /**
+     * @brief lost The number of records which were overwritten before they could be read
+     */
+    [[nodiscard]] auto lost() const -> std::uint64_t;
+
+private:
+    const ring_header* m_header { nullptr };
+    const std::byte* m_slots { nullptr };
+    std::size_t m_size { 0 };
+    std::size_t m_stride { slot_stride(sizeof(R)) };
+    std::uint64_t m_slot_count { 0 };
+    std::uint64_t m_next { 0 };
+    std::uint64_t m_lost { 0 };
+};
+
+// +++++++++++++++++++++++++++++++
+// implementation part starts here
+// +++++++++++++++++++++++++++++++
+
+template <typename R>
+ring_reader<R>::ring_reader(const std::string& name)
+{
+    const int fd { shm_open(name.c_str(), O_RDONLY, 0) };
+    if (fd < 0) {
+        return;
+    }
+    struct stat info { };
+    if ((fstat(fd, &info) != 0) || (static_cast<std::size_t>(info.st_size) < sizeof(ring_header))) {
+        close(fd);
+        return;
+    }
+    m_size = static_cast<std::size_t>(info.st_size);
+    void* memory { mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0) };
+    close(fd);
+    if (memory == MAP_FAILED) {
+        return;
+    }
+
+    const auto* header { static_cast<const ring_header*>(memory) };
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if ((header->magic != s_magic)
+        || (header->version != s_version)
+        || (header->type != record_traits<R>::type)
+        || (header->record_size != sizeof(R))
+        || (header->slot_count == 0)
+        || (ring_size(sizeof(R), header->slot_count) > m_size)) {
+        munmap(memory, m_size);
+        return;
+    }
+
+    m_header = header;
+    m_slots = static_cast<const std::byte*>(memory) + sizeof(ring_header);
+    m_slot_count = header->slot_count;
+    m_next = header->head.load(std::memory_order_acquire);
+}
+
+template <typename R>
+ring_reader<R>::~ring_reader()
+{
+    if (m_header != nullptr) {
+        munmap(const_cast<ring_header*>(m_header), m_size);
+    }
+}
+
+template <typename R>
+auto ring_reader<R>::next(R& record) -> bool
+{
+    if (m_header == nullptr) {
+        return false;
+    }
+    for (;;) {
+        const std::uint64_t head { m_header->head.load(std::memory_order_acquire) };
+        if (m_next >= head) {
+            return false;
+        }
+        if ((head - m_next) > m_slot_count) {
+            m_lost += head - m_slot_count - m_next;
+            m_next = head - m_slot_count;
+        }
+
+        const std::byte* slot { m_slots + (m_next % m_slot_count) * m_stride };
+        const auto* header { reinterpret_cast<const slot_header*>(slot) };
+        const std::uint64_t expected { 2 * m_next + 2 };
+
+        if (header->sequence.load(std::memory_order_acquire) != expected) {
+            // the producer has already started to overwrite the slot
+            m_lost++;
+            m_next++;
+            continue;
+        }
+        std::memcpy(&record, slot + sizeof(slot_header), sizeof(R));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (header->sequence.load(std::memory_order_relaxed) != expected) {
+            m_lost++;
+            m_next++;
+            continue;
+        }
+        m_next++;
+        return true;
+    }
+}
+
+template <typename R>
+auto ring_reader<R>::good() const -> bool
+{
+    return m_header != nullptr;
+}
+
+template <typename R>
+auto ring_reader<R>::closed() const -> bool
+{
+    return (m_header == nullptr) || (m_header->closed.load(std::memory_order_acquire) != 0);
+}
+
+template <typename R>
+auto ring_reader<R>::lost() const -> std::uint64_t
+{
+    return m_lost;
+}
+
+} // namespace muonpi::shm
+
+#endif // SHAREDRINGREADER_H
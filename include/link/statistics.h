@@ -0,0 +1,22 @@
+#ifndef LINKSTATISTICS_H
+#define LINKSTATISTICS_H
+
+#include <atomic>
+#include <cstddef>
+
+namespace muonpi::link {
+
+/**
+ * @brief The queue_statistics struct
+ * Describes the records of a link which have not been written yet.
+ * It is written by the thread of the link and may be read from any other thread.
+ */
+struct queue_statistics {
+    std::atomic<std::size_t> queued { 0 }; //!< The number of records waiting in memory
+    std::atomic<std::size_t> spilled { 0 }; //!< The number of records waiting in the spill file
+    std::atomic<std::size_t> dropped { 0 }; //!< The number of records lost since program start, because they could neither be written nor spilled
+};
+
+} // namespace muonpi::link
+
+#endif // LINKSTATISTICS_H
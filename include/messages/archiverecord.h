@@ -0,0 +1,24 @@
+#ifndef ARCHIVERECORD_H
+#define ARCHIVERECORD_H
+
+#include "messages/event.h"
+#include "utility/textbuffer.h"
+
+namespace muonpi::archive_record {
+
+/**
+ * Text representation of the records in the local archive, one line per record with space separated values.
+ * Shared by sink::archive and the archive-reader, so both always print the same format.
+ */
+
+/**
+ * @brief put Appends the lines of a coincidence, one line per contributing event:
+ * uuid n conflicting true_e user station_id hash start end time_acc ublox_counter fix utc gnss_time_grid lat lon h
+ * @param out The buffer to append to
+ * @param event The coincidence
+ */
+void put(text_buffer& out, const event_t& event);
+
+} // namespace muonpi::archive_record
+
+#endif // ARCHIVERECORD_H
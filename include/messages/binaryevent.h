@@ -0,0 +1,48 @@
+#ifndef BINARYEVENT_H
+#define BINARYEVENT_H
+
+#include "messages/event.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace muonpi::binary_event {
+
+/**
+ * Layout of a binary event payload. All values are little endian.
+ *
+ * offset | size | field
+ * -------+------+----------------------------------
+ *      0 |    1 | format version, currently 1
+ *      1 |    1 | fix
+ *      2 |    1 | utc
+ *      3 |    1 | gnss_time_grid
+ *      4 |    2 | ublox_counter
+ *      6 |    2 | reserved, 0
+ *      8 |    4 | time_acc in ns
+ *     12 |    4 | reserved, 0
+ *     16 |    8 | start in ns since epoch, signed
+ *     24 |    8 | end in ns since epoch, signed
+ */
+constexpr std::uint8_t version { 1 };
+constexpr std::size_t size { 32 };
+
+/**
+ * @brief decode Decodes a binary event payload. The identity of the detector is not part of the payload.
+ * @param payload The raw message content
+ * @param data The data object to write the values to
+ * @return true if the payload was a valid event of a known version
+ */
+[[nodiscard]] auto decode(std::string_view payload, event_t::data_t& data) -> bool;
+
+/**
+ * @brief encode Encodes event data into a binary event payload
+ * @param data The data to encode
+ * @return The payload
+ */
+[[nodiscard]] auto encode(const event_t::data_t& data) -> std::string;
+
+} // namespace muonpi::binary_event
+
+#endif // BINARYEVENT_H
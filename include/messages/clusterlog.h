@@ -21,6 +21,16 @@ struct cluster_log_t {
     std::size_t incoming { 0 }; //!< The number of incoming messages in the last interval
     std::map<std::size_t, std::size_t> outgoing {}; //!< The number of outgoing messages in the last interval, separated by coincidence level
     std::size_t buffer_length { 0 }; //!< the current number of event constructors in the buffer
+    struct {
+        std::size_t length { 0 }; //!< the current number of partially collected items in the source buffers
+        std::size_t expired { 0 }; //!< the number of items removed from the source buffers after their deadline, since program start
+        std::size_t dropped { 0 }; //!< the number of items rejected by the source buffers since program start, because they were full
+    } source_buffer;
+    struct {
+        std::size_t queued { 0 }; //!< the current number of database records waiting in memory to be written
+        std::size_t spilled { 0 }; //!< the current number of database records waiting in the spill file to be written
+        std::size_t dropped { 0 }; //!< the number of database records lost since program start
+    } database_queue;
     std::size_t total_detectors { 0 }; //!< The current total number of tracked detectors
     std::size_t reliable_detectors { 0 }; //!< The current number of tracked detectors deemed reliable
     std::size_t maximum_n { 0 }; //!< The maximum coincidence level found so far since program start
@@ -0,0 +1,140 @@
+#ifndef COLUMNAR_H
+#define COLUMNAR_H
+
+#include "messages/event.h"
+
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace muonpi::columnar {
+
+/**
+ * Columnar archive format for coincidences.
+ *
+ * A file starts with the magic number and the format version, followed by independent blocks.
+ * Each block starts with a header, which describes the time range of the contained coincidences,
+ * so blocks outside of a requested range are skipped without decompressing them.
+ * The block payload is compressed with zlib and stores one column per value:
+ * a dictionary of the detectors in the block, the columns of the coincidences and the columns of the contributing events.
+ * Timestamps are delta encoded and all integers are stored as variable length values, so the columns compress well.
+ *
+ * Files are partitioned by the hour of the coincidence start time.
+ */
+
+struct block_header {
+    std::uint32_t coincidences { 0 };
+    std::uint32_t rows { 0 }; //!< The total number of contributing events
+    std::int64_t first { 0 }; //!< The smallest coincidence start time in the block
+    std::int64_t last { 0 }; //!< The largest coincidence start time in the block
+    std::uint32_t raw_size { 0 };
+    std::uint32_t compressed_size { 0 };
+};
+
+/**
+ * @brief partition The start of the partition a time belongs to
+ * @param time The time in ns since epoch
+ * @return The start of the partition in ns since epoch
+ */
+[[nodiscard]] auto partition(std::int64_t time) -> std::int64_t;
+
+/**
+ * @brief file_name The name of the file of a partition
+ * @param partition_start The start of the partition as returned by partition()
+ */
+[[nodiscard]] auto file_name(std::int64_t partition_start) -> std::string;
+
+/**
+ * @brief files Finds the files of a directory whose partitions overlap a time range
+ * @param directory The directory to search
+ * @param from The start of the time range in ns since epoch
+ * @param to The end of the time range in ns since epoch
+ * @return The paths of the files, sorted by time
+ */
+[[nodiscard]] auto files(const std::string& directory, std::int64_t from, std::int64_t to) -> std::vector<std::string>;
+
+/**
+ * @brief write_file_header Writes the header at the start of a new file
+ * @return true on success
+ */
+[[nodiscard]] auto write_file_header(std::ostream& out) -> bool;
+
+/**
+ * @brief write_block Encodes, compresses and writes a block of coincidences
+ * @param out The stream to write to
+ * @param events The coincidences to write. Single events are ignored.
+ * @return true on success
+ */
+[[nodiscard]] auto write_block(std::ostream& out, const std::vector<event_t>& events) -> bool;
+
+/**
+ * @brief complete_size The size of the part of a file which consists of complete blocks
+ * @param path The file to check
+ * @return The position after the last complete block, 0 if the file has no valid header
+ */
+[[nodiscard]] auto complete_size(const std::string& path) -> std::uint64_t;
+
+/**
+ * @brief The file_reader class
+ * Reads the blocks of one columnar archive file.
+ */
+class file_reader {
+public:
+    /**
+     * @brief file_reader
+     * @param path The file to read
+     */
+    explicit file_reader(const std::string& path);
+
+    /**
+     * @brief good Checks whether the file could be opened and has the expected format
+     */
+    [[nodiscard]] auto good() const -> bool;
+
+    /**
+     * @brief next Reads the header of the next block
+     * @param header The header to read to
+     * @return false if there is no further complete block
+     */
+    [[nodiscard]] auto next(block_header& header) -> bool;
+
+    /**
+     * @brief skip Skips the payload of the block whose header was read last
+     */
+    [[nodiscard]] auto skip(const block_header& header) -> bool;
+
+    /**
+     * @brief read Decompresses and decodes the payload of the block whose header was read last
+     * @param header The header of the block
+     * @param events The vector the coincidences are appended to
+     * @return false if the block is damaged
+     */
+    [[nodiscard]] auto read(const block_header& header, std::vector<event_t>& events) -> bool;
+
+    /**
+     * @brief position The position in the file after the block which was read or skipped last
+     */
+    [[nodiscard]] auto position() -> std::uint64_t;
+
+private:
+    std::ifstream m_in {};
+    bool m_good { false };
+    std::string m_compressed {};
+    std::string m_raw {};
+};
+
+/**
+ * @brief scan Reads all coincidences of a directory which started within a time range
+ * @param directory The directory of the archive
+ * @param from The start of the time range in ns since epoch
+ * @param to The end of the time range in ns since epoch
+ * @param callback Called for each coincidence, in the order they were written
+ * @return The number of coincidences found
+ */
+auto scan(const std::string& directory, std::int64_t from, std::int64_t to, const std::function<void(const event_t&)>& callback) -> std::size_t;
+
+} // namespace muonpi::columnar
+
+#endif // COLUMNAR_H
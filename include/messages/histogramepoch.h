@@ -0,0 +1,180 @@
+#ifndef HISTOGRAMEPOCH_H
+#define HISTOGRAMEPOCH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace muonpi::epoch {
+
+/**
+ * Binary file format for one sample of the station pair histograms.
+ *
+ * All structs have a fixed layout with naturally aligned members and are stored in little endian byte order,
+ * so a file can be memory mapped and used in place.
+ * The writer stores the structs as they are in memory and the reader uses the mapped file directly,
+ * so both are only built for little endian hosts.
+ * A file starts with the file_header, followed by the names of the stations, the station table,
+ * the histogram blobs and the pair index. The header contains the offsets of all sections.
+ *
+ * Only pairs which had at least one coincidence have a blob. A blob contains the counts of all bins as 32 bit values,
+ * optionally compressed with zlib. Bin i of a pair covers [bin_width * (i - bins / 2), bin_width * (i - bins / 2 + 1)) ns.
+ */
+
+constexpr std::uint32_t s_magic { 0x4548504D }; // "MPHE"
+constexpr std::uint16_t s_version { 1 };
+constexpr std::uint16_t s_compressed { 0x1 }; //!< Flag for compressed histogram blobs
+
+struct file_header {
+    std::uint32_t magic { s_magic };
+    std::uint16_t version { s_version };
+    std::uint16_t flags { 0 };
+    std::int64_t start { 0 }; //!< Start of the sample in s since epoch
+    std::int64_t end { 0 }; //!< End of the sample in s since epoch
+    std::uint32_t stations { 0 };
+    std::uint32_t pairs { 0 };
+    std::uint32_t bins { 0 };
+    std::uint32_t reserved { 0 };
+    std::uint64_t names_offset { 0 };
+    std::uint64_t names_size { 0 };
+    std::uint64_t stations_offset { 0 };
+    std::uint64_t data_offset { 0 };
+    std::uint64_t data_size { 0 };
+    std::uint64_t pairs_offset { 0 };
+};
+
+struct station_entry {
+    std::uint64_t hash { 0 };
+    double lat { 0.0 };
+    double lon { 0.0 };
+    double h { 0.0 };
+    std::uint32_t name_offset { 0 }; //!< Position of the site id in the names section
+    std::uint32_t name_length { 0 };
+};
+
+struct pair_entry {
+    std::uint32_t first { 0 }; //!< Position of the first station in the station table
+    std::uint32_t second { 0 }; //!< Position of the second station in the station table
+    float distance { 0.0F }; //!< In m
+    std::int32_t bin_width { 0 }; //!< In ns
+    std::int32_t uptime { 0 }; //!< In min
+    std::uint32_t reserved { 0 };
+    std::uint64_t total { 0 };
+    std::uint64_t offset { 0 }; //!< Position of the blob in the data section
+    std::uint64_t size { 0 }; //!< Size of the blob, 0 if the pair had no coincidences
+};
+
+static_assert(sizeof(file_header) == 88);
+static_assert(sizeof(station_entry) == 40);
+static_assert(sizeof(pair_entry) == 48);
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "The epoch file structs are stored in host byte order, which has to be little endian");
+
+/**
+ * @brief file_name The name of the file for a sample
+ * @param stem The stem of the file, the sample end in hours since epoch
+ */
+[[nodiscard]] auto file_name(const std::string& stem) -> std::string;
+
+/**
+ * @brief The writer class
+ * Writes one epoch file. The stations are written on construction, the pairs are streamed to the file one by one.
+ * The file is written to a temporary file first and only moved to its final place by finish().
+ */
+class writer {
+public:
+    struct station {
+        std::uint64_t hash { 0 };
+        std::string name {};
+        double lat { 0.0 };
+        double lon { 0.0 };
+        double h { 0.0 };
+    };
+
+    /**
+     * @brief writer
+     * @param path The path of the file
+     * @param start Start of the sample in s since epoch
+     * @param end End of the sample in s since epoch
+     * @param bins The number of bins of each histogram
+     * @param compress Whether the histogram blobs should be compressed
+     * @param stations The station table
+     */
+    writer(std::string path, std::int64_t start, std::int64_t end, std::uint32_t bins, bool compress, const std::vector<station>& stations);
+
+    /**
+     * @brief add Writes one pair
+     * @param entry The pair. The total and the position of its blob are set by this method.
+     * @param counts The counts of all bins, nullptr if the pair had no coincidences
+     */
+    void add(pair_entry entry, const std::uint32_t* counts);
+
+    /**
+     * @brief finish Writes the pair index and moves the file to its final place
+     * @return true if the complete file was written
+     */
+    [[nodiscard]] auto finish() -> bool;
+
+private:
+    std::string m_path {};
+    std::string m_temporary {};
+    std::ofstream m_out {};
+    file_header m_header {};
+    std::vector<pair_entry> m_pairs {};
+    std::vector<char> m_compressed {};
+};
+
+/**
+ * @brief The reader class
+ * Memory maps an epoch file and gives access to its sections without copying them.
+ */
+class reader {
+public:
+    /**
+     * @brief reader
+     * @param path The file to read
+     */
+    explicit reader(const std::string& path);
+
+    ~reader();
+
+    reader(const reader&) = delete;
+    reader(reader&&) = delete;
+    auto operator=(const reader&) -> reader& = delete;
+    auto operator=(reader&&) -> reader& = delete;
+
+    /**
+     * @brief good Checks whether the file could be mapped and all sections are within the file
+     */
+    [[nodiscard]] auto good() const -> bool;
+
+    [[nodiscard]] auto header() const -> const file_header&;
+
+    [[nodiscard]] auto station(std::size_t index) const -> const station_entry&;
+
+    /**
+     * @brief name The site id of a station
+     */
+    [[nodiscard]] auto name(std::size_t index) const -> std::string_view;
+
+    [[nodiscard]] auto pair(std::size_t index) const -> const pair_entry&;
+
+    /**
+     * @brief counts Reads the counts of all bins of a pair
+     * @param entry The pair
+     * @param counts The vector to write the counts to, resized to the number of bins
+     * @return false if the blob is damaged
+     */
+    [[nodiscard]] auto counts(const pair_entry& entry, std::vector<std::uint32_t>& counts) const -> bool;
+
+private:
+    const std::byte* m_data { nullptr };
+    std::size_t m_size { 0 };
+    bool m_good { false };
+};
+
+} // namespace muonpi::epoch
+
+#endif // HISTOGRAMEPOCH_H
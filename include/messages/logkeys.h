@@ -0,0 +1,178 @@
+#ifndef LOGKEYS_H
+#define LOGKEYS_H
+
+#include "messages/detectorlog.h"
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+namespace muonpi::log_keys {
+
+/**
+ * @brief The id enum Identifies log keys which carry a special meaning for the processor
+ */
+enum class id : std::uint8_t {
+    other,
+    geo_height_msl,
+    geo_hor_accuracy,
+    geo_latitude,
+    geo_longitude,
+    geo_vert_accuracy,
+    position_dop,
+    max_geohash_length
+};
+
+struct entry {
+    std::string_view name {};
+    detector_log_t::item::Type type { detector_log_t::item::Type::String };
+    id key { id::other };
+};
+
+using Type = detector_log_t::item::Type;
+
+// clang-format off
+constexpr std::array<entry, 58> entries { {
+      {"UBX_HW_Version"       , Type::String}
+    , {"UBX_Prot_Version"     , Type::String}
+    , {"UBX_SW_Version"       , Type::String}
+    , {"hardwareVersionString", Type::String}
+    , {"softwareVersionString", Type::String}
+    , {"maxGeohashLength"     , Type::String, id::max_geohash_length}
+    , {"uniqueId"             , Type::String}
+    , {"geoHash"              , Type::String}
+
+    , {"gainSwitch"           , Type::Int}
+    , {"polaritySwitch1"      , Type::Int}
+    , {"polaritySwitch2"      , Type::Int}
+    , {"preampSwitch1"        , Type::Int}
+    , {"preampSwitch2"        , Type::Int}
+    , {"systemNrCPUs"         , Type::Int}
+
+    , {"geoHeightMSL"         , Type::Double, id::geo_height_msl}
+    , {"geoHorAccuracy"       , Type::Double, id::geo_hor_accuracy}
+    , {"geoLatitude"          , Type::Double, id::geo_latitude}
+    , {"geoLongitude"         , Type::Double, id::geo_longitude}
+    , {"geoVertAccuracy"      , Type::Double, id::geo_vert_accuracy}
+    , {"positionDOP"          , Type::Double, id::position_dop}
+    , {"RXBufUsage"           , Type::Double}
+    , {"TXBufUsage"           , Type::Double}
+    , {"adcSamplingTime"      , Type::Double}
+    , {"antennaPower"         , Type::Double}
+    , {"antennaStatus"        , Type::Double}
+    , {"biasDAC"              , Type::Double}
+    , {"biasSwitch"           , Type::Double}
+    , {"calib_coeff2"         , Type::Double}
+    , {"calib_coeff3"         , Type::Double}
+    , {"calib_rsense"         , Type::Double}
+    , {"calib_vdiv"           , Type::Double}
+    , {"clockBias"            , Type::Double}
+    , {"clockDrift"           , Type::Double}
+    , {"fixStatus"            , Type::Double}
+    , {"freqAccuracy"         , Type::Double}
+    , {"ibias"                , Type::Double}
+    , {"jammingLevel"         , Type::Double}
+    , {"maxCNR"               , Type::Double}
+    , {"maxRXBufUsage"        , Type::Double}
+    , {"meanGeoHeightMSL"     , Type::Double}
+    , {"preampAGC"            , Type::Double}
+    , {"preampNoise"          , Type::Double}
+    , {"rateAND"              , Type::Double}
+    , {"rateXOR"              , Type::Double}
+    , {"sats"                 , Type::Double}
+    , {"systemFreeMem"        , Type::Double}
+    , {"systemFreeSwap"       , Type::Double}
+    , {"systemLoadAvg"        , Type::Double}
+    , {"systemUptime"         , Type::Double}
+    , {"temperature"          , Type::Double}
+    , {"thresh1"              , Type::Double}
+    , {"thresh2"              , Type::Double}
+    , {"timeAccuracy"         , Type::Double}
+    , {"timeDOP"              , Type::Double}
+    , {"ubloxUptime"          , Type::Double}
+    , {"usedSats"             , Type::Double}
+    , {"vbias"                , Type::Double}
+    , {"vsense"               , Type::Double}
+} };
+// clang-format on
+
+namespace detail {
+    constexpr std::size_t table_size { 512 };
+    constexpr std::size_t table_mask { table_size - 1 };
+
+    /**
+     * @brief hash seeded FNV-1a hash of a string
+     */
+    [[nodiscard]] constexpr auto hash(std::string_view name, std::uint32_t seed) -> std::uint32_t
+    {
+        std::uint32_t h { 2166136261U ^ seed };
+        for (const char c : name) {
+            h ^= static_cast<std::uint8_t>(c);
+            h *= 16777619U;
+        }
+        return h;
+    }
+
+    /**
+     * @brief collision_free Checks whether a seed maps all entries to distinct slots
+     */
+    [[nodiscard]] constexpr auto collision_free(std::uint32_t seed) -> bool
+    {
+        std::array<bool, table_size> used {};
+        for (const auto& e : entries) {
+            const std::size_t slot { hash(e.name, seed) & table_mask };
+            if (used[slot]) {
+                return false;
+            }
+            used[slot] = true;
+        }
+        return true;
+    }
+
+    [[nodiscard]] constexpr auto find_seed() -> std::uint32_t
+    {
+        std::uint32_t seed { 0 };
+        while (!collision_free(seed)) {
+            seed++;
+        }
+        return seed;
+    }
+
+    constexpr std::uint32_t seed { find_seed() };
+
+    /**
+     * @brief build_table Creates the slot table. Each slot contains the entry index + 1, or 0 if it is empty.
+     */
+    [[nodiscard]] constexpr auto build_table() -> std::array<std::uint8_t, table_size>
+    {
+        std::array<std::uint8_t, table_size> table {};
+        for (std::size_t i { 0 }; i < entries.size(); i++) {
+            table[hash(entries[i].name, seed) & table_mask] = static_cast<std::uint8_t>(i + 1);
+        }
+        return table;
+    }
+
+    constexpr std::array<std::uint8_t, table_size> table { build_table() };
+} // namespace detail
+
+/**
+ * @brief find Looks up a log key with one hash and one comparison
+ * @param name The key name as received in the log message
+ * @return A pointer to the matching entry, nullptr if the key is unknown
+ */
+[[nodiscard]] constexpr auto find(std::string_view name) -> const entry*
+{
+    const std::uint8_t index { detail::table[detail::hash(name, detail::seed) & detail::table_mask] };
+    if ((index == 0) || (entries[index - 1].name != name)) {
+        return nullptr;
+    }
+    return &entries[index - 1];
+}
+
+static_assert(find("geoLatitude")->key == id::geo_latitude);
+static_assert(find("vsense")->type == Type::Double);
+static_assert(find("unknownKey") == nullptr);
+
+} // namespace muonpi::log_keys
+
+#endif // LOGKEYS_H
@@ -0,0 +1,30 @@
+#ifndef SERIALISATION_H
+#define SERIALISATION_H
+
+#include "messages/detectorinfo.h"
+#include "messages/event.h"
+#include "messages/userinfo.h"
+#include "utility/binarystream.h"
+
+namespace muonpi::binary {
+
+/**
+ * Binary representations of the message types which are persisted between runs.
+ * The get functions leave the reader in a failed state if the data could not be read, check with reader::good().
+ */
+
+void put(writer& out, const userinfo_t& userinfo);
+void get(reader& in, userinfo_t& userinfo);
+
+void put(writer& out, const location_t& location);
+void get(reader& in, location_t& location);
+
+void put(writer& out, const event_t::data_t& data);
+void get(reader& in, event_t::data_t& data);
+
+void put(writer& out, const event_t& event);
+void get(reader& in, event_t& event);
+
+} // namespace muonpi::binary
+
+#endif // SERIALISATION_H
@@ -0,0 +1,107 @@
+#ifndef SHAREDRECORD_H
+#define SHAREDRECORD_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace muonpi::shm {
+
+/**
+ * Fixed binary layout of the shared memory rings written by link::shared_ring.
+ * All structs only contain fixed width values, so they can be read by any process on the same machine.
+ *
+ * The memory of a ring starts with the ring_header, followed by slot_count slots of slot_stride(record_size) bytes each.
+ * Each slot starts with its sequence number, followed by the record.
+ * The record with sequence number s is stored in slot s % slot_count. While it is written, the sequence of the slot is 2s + 1, afterwards 2s + 2.
+ */
+
+constexpr std::uint32_t s_magic { 0x5253504D }; // "MPSR"
+constexpr std::uint32_t s_version { 1 };
+constexpr std::size_t s_name_length { 32 };
+constexpr std::size_t s_max_members { 16 };
+constexpr std::size_t s_cache_line { 64 };
+
+enum class record_type : std::uint32_t {
+    event = 1,
+    detector_summary = 2
+};
+
+struct event_member {
+    std::uint64_t hash { 0 };
+    std::int64_t start { 0 };
+    std::int64_t end { 0 };
+    double lat { 0.0 };
+    double lon { 0.0 };
+    double h { 0.0 };
+    std::uint32_t time_acc { 0 };
+    std::uint16_t ublox_counter { 0 };
+    std::uint8_t fix { 0 };
+    std::uint8_t utc { 0 };
+    std::uint8_t gnss_time_grid { 0 };
+    std::uint8_t reserved[7] {};
+    char user[s_name_length] {}; //!< Zero terminated, truncated if longer
+    char station_id[s_name_length] {}; //!< Zero terminated, truncated if longer
+};
+
+struct event_record {
+    std::uint64_t hash { 0 }; //!< The hash of the coincidence, used for its uuid
+    std::int64_t start { 0 };
+    std::int64_t end { 0 };
+    std::uint16_t n { 0 }; //!< The multiplicity of the coincidence
+    std::uint16_t members { 0 }; //!< The number of valid entries in member, at most s_max_members
+    std::uint8_t conflicting { 0 };
+    std::uint8_t true_e { 0 };
+    std::uint8_t reserved[2] {};
+    event_member member[s_max_members] {};
+};
+
+struct detector_summary_record {
+    std::int64_t time { 0 }; //!< The time the summary was created in ns since epoch
+    double mean_eventrate { 0.0 };
+    double stddev_eventrate { 0.0 };
+    double mean_time_acc { 0.0 };
+    double mean_pulselength { 0.0 };
+    double deadtime { 0.0 };
+    std::uint64_t incoming { 0 };
+    std::int64_t ublox_counter_progress { 0 };
+    char user[s_name_length] {};
+    char station_id[s_name_length] {};
+};
+
+struct alignas(s_cache_line) ring_header {
+    std::uint32_t magic { 0 };
+    std::uint32_t version { 0 };
+    record_type type { record_type::event };
+    std::uint32_t record_size { 0 };
+    std::uint64_t slot_count { 0 };
+    std::atomic<std::uint32_t> closed { 0 }; //!< Set once the producer has stopped. Readers should reopen the ring later.
+    alignas(s_cache_line) std::atomic<std::uint64_t> head { 0 }; //!< The sequence number of the next record
+};
+
+struct slot_header {
+    std::atomic<std::uint64_t> sequence { 0 };
+};
+
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "The shared memory ring needs lock free 64 bit atomics.");
+
+/**
+ * @brief slot_stride The distance between two slots
+ * @param record_size The size of the records in the ring
+ */
+[[nodiscard]] constexpr auto slot_stride(std::size_t record_size) -> std::size_t
+{
+    return ((sizeof(slot_header) + record_size + s_cache_line - 1) / s_cache_line) * s_cache_line;
+}
+
+/**
+ * @brief ring_size The total size of the shared memory of a ring
+ */
+[[nodiscard]] constexpr auto ring_size(std::size_t record_size, std::size_t slot_count) -> std::size_t
+{
+    return sizeof(ring_header) + slot_stride(record_size) * slot_count;
+}
+
+} // namespace muonpi::shm
+
+#endif // SHAREDRECORD_H
@@ -0,0 +1,122 @@
+#ifndef ARCHIVESINK_H
+#define ARCHIVESINK_H
+
+#include "messages/archiverecord.h"
+#include "messages/detectorsummary.h"
+#include "messages/event.h"
+#include "messages/trigger.h"
+#include "utility/textbuffer.h"
+
+#include "link/archive.h"
+
+#include <muonpi/sink/base.h>
+
+#include <chrono>
+#include <string>
+
+namespace muonpi::sink {
+
+template <typename T>
+/**
+ * @brief The archive class
+ * Writes messages to a local link::archive, one line per record with space separated values.
+ *
+ * Coincidences are written as one line per contributing event:
+ * uuid n conflicting true_e user station_id hash start end time_acc ublox_counter fix utc gnss_time_grid lat lon h
+ *
+ * Detector summaries:
+ * time user station_id eventrate eventrate_stddev time_acc pulselength incoming ublox_counter_progress deadtime_factor
+ *
+ * Triggers:
+ * time user station_id status reason
+ *
+ * Times are in ns since epoch.
+ */
+class archive : public base<T> {
+public:
+    /**
+     * @brief archive
+     * @param link The archive the records are written to
+     */
+    archive(link::archive& link);
+
+    /**
+     * @brief get Reimplemented from sink::base
+     * @param message
+     */
+    void get(T message) override;
+
+private:
+    [[nodiscard]] static auto now() -> std::int_fast64_t;
+
+    link::archive& m_link;
+
+    text_buffer m_buffer {};
+};
+
+// +++++++++++++++++++++++++++++++
+// implementation part starts here
+// +++++++++++++++++++++++++++++++
+
+template <typename T>
+archive<T>::archive(link::archive& link)
+    : m_link { link }
+{
+}
+
+template <typename T>
+auto archive<T>::now() -> std::int_fast64_t
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+template <>
+void archive<event_t>::get(event_t event)
+{
+    if (event.n() < 2) {
+        return;
+    }
+
+    m_buffer.clear();
+    archive_record::put(m_buffer, event);
+    m_link.append(event.data.start, m_buffer.view());
+}
+
+template <>
+void archive<detector_summary_t>::get(detector_summary_t log)
+{
+    const auto time { now() };
+    m_buffer.clear();
+    m_buffer
+        << time
+        << ' ' << log.userinfo.username
+        << ' ' << log.userinfo.station_id
+        << ' ' << log.mean_eventrate
+        << ' ' << log.stddev_eventrate
+        << ' ' << log.mean_time_acc
+        << ' ' << log.mean_pulselength
+        << ' ' << log.incoming
+        << ' ' << log.ublox_counter_progress
+        << ' ' << log.deadtime
+        << '\n';
+    m_link.append(time, m_buffer.view());
+}
+
+template <>
+void archive<trigger::detector>::get(trigger::detector trigger)
+{
+    const auto time { now() };
+    m_buffer.clear();
+    m_buffer
+        << time
+        << ' ' << trigger.userinfo.username
+        << ' ' << trigger.userinfo.station_id
+        << ' ' << detector_status::to_string(trigger.status)
+        << ' ' << detector_status::to_string(trigger.reason)
+        << '\n';
+    m_link.append(time, m_buffer.view());
+}
+
+} // namespace muonpi::sink
+
+#endif // ARCHIVESINK_H
@@ -5,6 +5,7 @@
 #include "messages/detectorsummary.h"
 #include "messages/event.h"
 #include "messages/trigger.h"
+#include "utility/textbuffer.h"
 
 #include <muonpi/sink/base.h>
 #include <muonpi/utility.h>
@@ -35,7 +36,15 @@ public:
     void get(T message) override;
 
 private:
+    /**
+     * @brief write Writes the content of the buffer to the output stream
+     * @param flush Flush the stream afterwards
+     */
+    void write(bool flush = true);
+
     std::ostream& m_ostream;
+
+    text_buffer m_buffer {};
 };
 
 template <typename T>
@@ -47,6 +56,15 @@ ascii<T>::ascii(std::ostream& ostream)
 template <typename T>
 ascii<T>::~ascii() = default;
 
+template <typename T>
+void ascii<T>::write(bool flush)
+{
+    m_ostream.write(m_buffer.view().data(), static_cast<std::streamsize>(m_buffer.size()));
+    if (flush) {
+        m_ostream.flush();
+    }
+}
+
 template <>
 void ascii<event_t>::get(event_t event)
 {
@@ -54,38 +72,38 @@ void ascii<event_t>::get(event_t event)
         return;
     }
 
-    guid uuid { event.data.hash, static_cast<std::uint64_t>(event.data.start) };
+    const std::string uuid { guid { event.data.hash, static_cast<std::uint64_t>(event.data.start) }.to_string() };
     const std::int64_t cluster_coinc_time = event.duration();
-    std::ostringstream out {};
     double max_e { static_cast<double>(event.n() * event.n() - event.n()) * 0.5 };
 
-    out << "Combined event_t: (" << event.n() << ": " << static_cast<double>(event.true_e) / max_e << ")" << ((event.conflicting) ? " C " : "") << ": coinc_time: " << cluster_coinc_time;
+    m_buffer.clear();
+    m_buffer << "Combined event_t: (" << event.n() << ": " << static_cast<double>(event.true_e) / max_e << ")" << ((event.conflicting) ? " C " : "") << ": coinc_time: " << cluster_coinc_time;
     for (const auto& evt : event.events) {
         const std::int64_t evt_coinc_time = evt.start - event.data.start;
-        out
-            << "\n\t" << std::hex << uuid.to_string() << std::dec << ' ' << evt_coinc_time
+        m_buffer
+            << "\n\t" << uuid << ' ' << evt_coinc_time
             << ' ' << evt.user
             << ' ' << evt.station_id
             << ' ' << evt.start
             << ' ' << evt.duration()
             << ' ' << evt.time_acc
             << ' ' << evt.ublox_counter
-            << ' ' << static_cast<std::uint16_t>(evt.fix)
-            << ' ' << static_cast<std::uint16_t>(evt.utc)
-            << ' ' << static_cast<std::uint16_t>(evt.gnss_time_grid);
+            << ' ' << evt.fix
+            << ' ' << evt.utc
+            << ' ' << evt.gnss_time_grid;
     }
 
-    out << '\n';
+    m_buffer << '\n';
 
-    m_ostream << out.str() << std::flush;
+    // events are frequent, the stream is flushed by its own buffering
+    write(false);
 }
 
 template <>
 void ascii<cluster_log_t>::get(cluster_log_t log)
 {
-    std::ostringstream out {};
-
-    out
+    m_buffer.clear();
+    m_buffer
         << "Cluster Log:"
         << "\n\tversion: " << Version::dnp::string()
         << "\n\ttimeout: " << log.timeout << " ms"
@@ -94,6 +112,8 @@ void ascii<cluster_log_t>::get(cluster_log_t log)
         << "\n\tin: " << log.frequency.single_in << " Hz"
         << "\n\tout: " << log.frequency.l1_out << " Hz"
         << "\n\tbuffer: " << log.buffer_length
+        << "\n\tsource buffer: " << log.source_buffer.length << " (expired: " << log.source_buffer.expired << ", dropped: " << log.source_buffer.dropped << ")"
+        << "\n\tdatabase queue: " << log.database_queue.queued << " (spilled: " << log.database_queue.spilled << ", dropped: " << log.database_queue.dropped << ")"
         << "\n\tevents in interval: " << log.incoming
         << "\n\tcpu load: " << log.system_cpu_load
         << "\n\tprocess cpu load: " << log.process_cpu_load
@@ -102,23 +122,22 @@ void ascii<cluster_log_t>::get(cluster_log_t log)
         << "\n\tout in interval: ";
 
     for (auto& [n, i] : log.outgoing) {
-        out << "(" << n << ":" << i << ") ";
+        m_buffer << "(" << n << ":" << i << ") ";
     }
 
-    out
+    m_buffer
         << "\n\tdetectors: " << log.total_detectors << "(" << log.reliable_detectors << ")"
         << "\n\tmaximum n: " << log.maximum_n << '\n';
 
-    m_ostream << out.str() << std::flush;
+    write();
 }
 
 template <>
 void ascii<detector_summary_t>::get(detector_summary_t log)
 {
-    std::ostringstream out {};
-
-    out
-        << "Detector Summary: " << log.userinfo.site_id()
+    m_buffer.clear();
+    m_buffer
+        << "Detector Summary: " << log.userinfo.username << log.userinfo.station_id
         << "\n\teventrate: " << log.mean_eventrate
         << "\n\teventrate stddev: " << log.stddev_eventrate
         << "\n\tpulselength: " << log.mean_pulselength
@@ -127,7 +146,7 @@ void ascii<detector_summary_t>::get(detector_summary_t log)
         << "\n\tdeadtime factor: " << log.deadtime
         << '\n';
 
-    m_ostream << out.str() << std::flush;
+    write();
 }
 
 template <>
@@ -137,12 +156,12 @@ void ascii<trigger::detector>::get(trigger::detector trigger)
         return;
     }
 
-    std::ostringstream stream {};
-    stream << trigger.userinfo.username << ' ' << trigger.userinfo.station_id
-           << ' ' << detector_status::to_string(trigger.status)
-           << ' ' << detector_status::to_string(trigger.reason) << '\n';
+    m_buffer.clear();
+    m_buffer << trigger.userinfo.username << ' ' << trigger.userinfo.station_id
+             << ' ' << detector_status::to_string(trigger.status)
+             << ' ' << detector_status::to_string(trigger.reason) << '\n';
 
-    m_ostream << stream.str() << std::flush;
+    write();
 }
 
 }
@@ -0,0 +1,56 @@
+#ifndef COLUMNARSINK_H
+#define COLUMNARSINK_H
+
+#include "messages/event.h"
+
+#include "link/columnararchive.h"
+
+#include <muonpi/sink/base.h>
+
+namespace muonpi::sink {
+
+template <typename T>
+/**
+ * @brief The columnar class
+ * Writes coincidences to a link::columnar_archive for offline analysis.
+ */
+class columnar : public base<T> {
+public:
+    /**
+     * @brief columnar
+     * @param link The archive the coincidences are written to
+     */
+    columnar(link::columnar_archive& link);
+
+    /**
+     * @brief get Reimplemented from sink::base
+     * @param message
+     */
+    void get(T message) override;
+
+private:
+    link::columnar_archive& m_link;
+};
+
+// +++++++++++++++++++++++++++++++
+// implementation part starts here
+// +++++++++++++++++++++++++++++++
+
+template <typename T>
+columnar<T>::columnar(link::columnar_archive& link)
+    : m_link { link }
+{
+}
+
+template <>
+void columnar<event_t>::get(event_t event)
+{
+    if (event.n() < 2) {
+        return;
+    }
+    m_link.add(std::move(event));
+}
+
+} // namespace muonpi::sink
+
+#endif // COLUMNARSINK_H
@@ -7,13 +7,14 @@
 #include "messages/event.h"
 #include "messages/trigger.h"
 
-#include <muonpi/link/influx.h>
+#include "link/influxbatch.h"
+
 #include <muonpi/log.h>
 #include <muonpi/sink/base.h>
 #include <muonpi/utility.h>
 
 #include <memory>
-#include <sstream>
+#include <string_view>
 
 namespace muonpi::sink {
 
@@ -25,9 +26,9 @@ class database : public base<T> {
 public:
     /**
      * @brief databaseLogsink
-     * @param link a link::database instance
+     * @param link a link::influx_batch instance, which collects the records and writes them in batches
      */
-    database(link::influx& link);
+    database(link::influx_batch& link);
 
     /**
      * @brief get Reimplemented from sink::base
@@ -36,11 +37,16 @@ public:
     void get(T message) override;
 
 private:
-    link::influx& m_link;
+    link::influx_batch& m_link;
+
+    text_buffer m_buffer {};
+    text_buffer m_site_id { s_site_id_capacity };
+
+    static constexpr std::size_t s_site_id_capacity { 64 };
 
-    using tag = link::influx::tag;
+    using tag = link::influx_batch::tag;
     template <typename F>
-    using field = link::influx::field<F>;
+    using field = link::influx_batch::field<F>;
 };
 
 // +++++++++++++++++++++++++++++++
@@ -48,7 +54,7 @@ private:
 // +++++++++++++++++++++++++++++++
 
 template <class T>
-database<T>::database(link::influx& link)
+database<T>::database(link::influx_batch& link)
     : m_link { link }
 {
 }
@@ -57,7 +63,7 @@ template <>
 void database<cluster_log_t>::get(cluster_log_t log)
 {
     const auto nanosecondsUTC { std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count() };
-    auto fields { std::move(m_link.measurement("cluster_summary")
+    auto fields { std::move(m_link.measurement("cluster_summary", m_buffer)
         << tag { "cluster_id", log.station_id }
         << field<std::string> { "version", Version::dnp::string() }
         << field<std::int_fast64_t> { "timeout", log.timeout }
@@ -66,6 +72,12 @@ void database<cluster_log_t>::get(cluster_log_t log)
         << field<double> { "frequency_in", log.frequency.single_in }
         << field<double> { "frequency_l1_out", log.frequency.l1_out }
         << field<std::size_t> { "buffer_length", log.buffer_length }
+        << field<std::size_t> { "source_buffer_length", log.source_buffer.length }
+        << field<std::size_t> { "source_buffer_expired", log.source_buffer.expired }
+        << field<std::size_t> { "source_buffer_dropped", log.source_buffer.dropped }
+        << field<std::size_t> { "database_queued", log.database_queue.queued }
+        << field<std::size_t> { "database_spilled", log.database_queue.spilled }
+        << field<std::size_t> { "database_dropped", log.database_queue.dropped }
         << field<std::size_t> { "total_detectors", log.total_detectors }
         << field<std::size_t> { "reliable_detectors", log.reliable_detectors }
         << field<std::size_t> { "max_multiplicity", log.maximum_n }
@@ -96,7 +108,7 @@ template <>
 void database<detector_summary_t>::get(detector_summary_t log)
 {
     const auto nanosecondsUTC { std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count() };
-    auto result { std::move((m_link.measurement("detector_summary")
+    auto result { std::move((m_link.measurement("detector_summary", m_buffer)
         << tag { "user", log.userinfo.username }
         << tag { "detector", log.userinfo.station_id }
         << tag { "site_id", log.userinfo.site_id() }
@@ -118,7 +130,7 @@ template <>
 void database<trigger::detector>::get(trigger::detector trig)
 {
     const auto nanosecondsUTC { std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count() };
-    auto result { std::move(m_link.measurement("trigger")
+    auto result { std::move(m_link.measurement("trigger", m_buffer)
         << tag { "user", trig.userinfo.username }
         << tag { "detector", trig.userinfo.station_id }
         << tag { "site_id", trig.userinfo.site_id() }
@@ -139,15 +151,17 @@ void database<event_t>::get(event_t event)
     }
 
     const std::int64_t cluster_coinc_time = event.duration();
-    guid uuid { event.data.hash, static_cast<std::uint64_t>(event.data.start) };
+    const std::string uuid { guid { event.data.hash, static_cast<std::uint64_t>(event.data.start) }.to_string() };
     double plausibility { static_cast<double>(event.true_e) / (static_cast<double>(event.n() * event.n() - event.n()) * 0.5) };
     for (auto& evt : event.events) {
-        if (!(m_link.measurement("L1Event")
+        m_site_id.clear();
+        m_site_id << evt.user << evt.station_id;
+        if (!(m_link.measurement("L1Event", m_buffer)
                 << tag { "user", evt.user }
                 << tag { "detector", evt.station_id }
-                << tag { "site_id", evt.user + evt.station_id }
+                << tag { "site_id", m_site_id.view() }
                 << field<std::uint32_t> { "accuracy", evt.time_acc }
-                << field<std::string> { "uuid", uuid.to_string() }
+                << field<std::string_view> { "uuid", uuid }
                 << field<std::size_t> { "coinc_level", event.n() }
                 << field<std::uint16_t> { "counter", evt.ublox_counter }
                 << field<std::int_fast64_t> { "length", evt.duration() }
@@ -168,7 +182,7 @@ template <>
 void database<detector_log_t>::get(detector_log_t log)
 {
     auto nanosecondsUTC { std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count() };
-    auto entry { m_link.measurement("detector_log") };
+    auto entry { m_link.measurement("detector_log", m_buffer) };
     entry << tag { "user", log.userinfo.username }
           << tag { "detector", log.userinfo.station_id }
           << tag { "site_id", log.userinfo.site_id() };
@@ -7,19 +7,19 @@
 #include "messages/detectorsummary.h"
 #include "messages/event.h"
 #include "messages/trigger.h"
+#include "utility/textbuffer.h"
 
 #include <muonpi/link/mqtt.h>
 #include <muonpi/sink/base.h>
 
-#include <muonpi/gnss.h>
 #include <muonpi/log.h>
 #include <muonpi/utility.h>
-#include <muonpi/units.h>
 
+#include <chrono>
 #include <ctime>
-#include <iomanip>
 #include <memory>
 #include <string>
+#include <string_view>
 
 namespace muonpi::sink {
 
@@ -33,8 +33,9 @@ public:
      * @brief mqtt
      * @param publisher The topic from which the messages should be published
      * @paragraph detailed if false, anonymises the users of mqtt messages
+     * @param compact if true, cluster logs and detector summaries are published as one message of key=value pairs instead of one message per value
      */
-    mqtt(link::mqtt::publisher& publisher, bool detailed = false);
+    mqtt(link::mqtt::publisher& publisher, bool detailed = false, bool compact = false);
 
     ~mqtt() override;
 
@@ -45,40 +46,42 @@ public:
     void get(T message) override;
 
 private:
-    class constructor {
-    public:
-        constructor(std::ostringstream stream)
-            : m_stream { std::move(stream) }
-        {
-        }
-
-        template <typename U>
-        auto operator<<(U value) -> constructor&
-        {
-            m_stream << ' ' << value;
-            return *this;
-        }
-
-        auto str() -> std::string
-        {
-            return m_stream.str();
-        }
+    /**
+     * @brief publish_value Publishes a single value, prefixed by the current content of the buffer up to prefix
+     * @param prefix The length of the common prefix in the buffer
+     * @param name The name of the value
+     * @param value The value to publish
+     */
+    template <typename V>
+    void publish_value(std::size_t prefix, std::string_view name, const V& value);
 
-    private:
-        std::ostringstream m_stream;
-    };
+    /**
+     * @brief start_message Clears the buffer and starts a new message with the current time
+     * @param format The strftime format to use
+     */
+    void start_message(const char* format = "%F_%H-%M-%S");
 
-    [[nodiscard]] auto construct(const std::string& time, const std::string& parname) -> constructor;
+    /**
+     * @brief topic Formats the subtopic of a detector
+     */
+    [[nodiscard]] auto topic(const std::string& user, const std::string& station_id) -> const std::string&;
 
     link::mqtt::publisher& m_link;
 
     bool m_detailed { false };
+    bool m_compact { false };
+
+    text_buffer m_buffer {};
+    text_buffer m_topic { s_topic_capacity };
+
+    static constexpr std::size_t s_topic_capacity { 64 };
 };
 
 template <typename T>
-mqtt<T>::mqtt(link::mqtt::publisher& publisher, bool detailed)
+mqtt<T>::mqtt(link::mqtt::publisher& publisher, bool detailed, bool compact)
     : m_link { publisher }
     , m_detailed { detailed }
+    , m_compact { compact }
 {
 }
 
@@ -86,61 +89,129 @@ template <typename T>
 mqtt<T>::~mqtt() = default;
 
 template <typename T>
-auto mqtt<T>::construct(const std::string& time, const std::string& parname) -> constructor
+template <typename V>
+void mqtt<T>::publish_value(std::size_t prefix, std::string_view name, const V& value)
 {
-    std::ostringstream stream {};
+    m_buffer.truncate(prefix);
+    m_buffer << ' ' << name << ' ' << value;
+    m_link.publish(m_buffer.str());
+}
 
-    stream << time << ' ' << parname;
+template <typename T>
+void mqtt<T>::start_message(const char* format)
+{
+    m_buffer.clear();
+    m_buffer.append_time(std::chrono::system_clock::to_time_t(std::chrono::system_clock::now()), format);
+}
 
-    return constructor { std::move(stream) };
+template <typename T>
+auto mqtt<T>::topic(const std::string& user, const std::string& station_id) -> const std::string&
+{
+    m_topic.clear();
+    m_topic << user << '/' << station_id;
+    return m_topic.str();
 }
 
 template <>
 void mqtt<cluster_log_t>::get(cluster_log_t log)
 {
-    std::time_t time { std::chrono::system_clock::to_time_t(std::chrono::system_clock::now()) };
-    std::ostringstream stream {};
-    stream << std::put_time(std::gmtime(&time), "%F_%H-%M-%S");
-    m_link.publish((construct(stream.str(), "timeout") << log.timeout).str());
-    m_link.publish((construct(stream.str(), "version") << Version::dnp::string()).str());
-    m_link.publish((construct(stream.str(), "timebase") << log.timebase).str());
-    m_link.publish((construct(stream.str(), "uptime") << log.uptime).str());
-    m_link.publish((construct(stream.str(), "frequency_in") << log.frequency.single_in).str());
-    m_link.publish((construct(stream.str(), "frequency_l1_out") << log.frequency.l1_out).str());
-    m_link.publish((construct(stream.str(), "buffer_length") << log.buffer_length).str());
-    m_link.publish((construct(stream.str(), "total_detectors") << log.total_detectors).str());
-    m_link.publish((construct(stream.str(), "reliable_detectors") << log.reliable_detectors).str());
-    m_link.publish((construct(stream.str(), "max_coincidences") << log.maximum_n).str());
-    m_link.publish((construct(stream.str(), "cpu_load") << log.system_cpu_load).str());
-    m_link.publish((construct(stream.str(), "process_cpu_load") << log.process_cpu_load).str());
-    m_link.publish((construct(stream.str(), "memory_usage") << log.memory_usage).str());
-    m_link.publish((construct(stream.str(), "plausibility_level") << log.plausibility_level).str());
-    m_link.publish((construct(stream.str(), "incoming") << log.incoming).str());
+    start_message();
+
+    if (m_compact) {
+        m_buffer
+            << " timeout=" << log.timeout
+            << " version=" << Version::dnp::string()
+            << " timebase=" << log.timebase
+            << " uptime=" << log.uptime
+            << " frequency_in=" << log.frequency.single_in
+            << " frequency_l1_out=" << log.frequency.l1_out
+            << " buffer_length=" << log.buffer_length
+            << " source_buffer_length=" << log.source_buffer.length
+            << " source_buffer_expired=" << log.source_buffer.expired
+            << " source_buffer_dropped=" << log.source_buffer.dropped
+            << " database_queued=" << log.database_queue.queued
+            << " database_spilled=" << log.database_queue.spilled
+            << " database_dropped=" << log.database_queue.dropped
+            << " total_detectors=" << log.total_detectors
+            << " reliable_detectors=" << log.reliable_detectors
+            << " max_coincidences=" << log.maximum_n
+            << " cpu_load=" << log.system_cpu_load
+            << " process_cpu_load=" << log.process_cpu_load
+            << " memory_usage=" << log.memory_usage
+            << " plausibility_level=" << log.plausibility_level
+            << " incoming=" << log.incoming;
+        for (auto& [level, n] : log.outgoing) {
+            if (level == 1) {
+                continue;
+            }
+            m_buffer << " outgoing_" << level << '=' << n;
+        }
+        m_link.publish(m_buffer.str());
+        return;
+    }
+
+    const std::size_t time { m_buffer.size() };
+
+    publish_value(time, "timeout", log.timeout);
+    publish_value(time, "version", Version::dnp::string());
+    publish_value(time, "timebase", log.timebase);
+    publish_value(time, "uptime", log.uptime);
+    publish_value(time, "frequency_in", log.frequency.single_in);
+    publish_value(time, "frequency_l1_out", log.frequency.l1_out);
+    publish_value(time, "buffer_length", log.buffer_length);
+    publish_value(time, "source_buffer_length", log.source_buffer.length);
+    publish_value(time, "source_buffer_expired", log.source_buffer.expired);
+    publish_value(time, "source_buffer_dropped", log.source_buffer.dropped);
+    publish_value(time, "database_queued", log.database_queue.queued);
+    publish_value(time, "database_spilled", log.database_queue.spilled);
+    publish_value(time, "database_dropped", log.database_queue.dropped);
+    publish_value(time, "total_detectors", log.total_detectors);
+    publish_value(time, "reliable_detectors", log.reliable_detectors);
+    publish_value(time, "max_coincidences", log.maximum_n);
+    publish_value(time, "cpu_load", log.system_cpu_load);
+    publish_value(time, "process_cpu_load", log.process_cpu_load);
+    publish_value(time, "memory_usage", log.memory_usage);
+    publish_value(time, "plausibility_level", log.plausibility_level);
+    publish_value(time, "incoming", log.incoming);
 
     for (auto& [level, n] : log.outgoing) {
         if (level == 1) {
             continue;
         }
-        m_link.publish((construct(stream.str(), "outgoing_" + std::to_string(level)) << n).str());
+        m_buffer.truncate(time);
+        m_buffer << " outgoing_" << level << ' ' << n;
+        m_link.publish(m_buffer.str());
     }
 }
 
 template <>
 void mqtt<detector_summary_t>::get(detector_summary_t log)
 {
-    std::time_t time { std::chrono::system_clock::to_time_t(std::chrono::system_clock::now()) };
-    std::ostringstream stream {};
-    stream << std::put_time(std::gmtime(&time), "%F_%H-%M-%S");
-
-    std::string name { log.userinfo.username + " " + log.userinfo.station_id };
-
-    m_link.publish((construct(stream.str(), name + " eventrate") << log.mean_eventrate).str());
-    m_link.publish((construct(stream.str(), name + " eventrate_stddev") << log.stddev_eventrate).str());
-    m_link.publish((construct(stream.str(), name + " time_acc") << log.mean_time_acc).str());
-    m_link.publish((construct(stream.str(), name + " pulselength") << log.mean_pulselength).str());
-    m_link.publish((construct(stream.str(), name + " incoming") << log.incoming).str());
-    m_link.publish((construct(stream.str(), name + " ublox_counter_progess") << log.ublox_counter_progress).str());
-    m_link.publish((construct(stream.str(), name + " deadtime_factor") << log.deadtime).str());
+    start_message();
+    m_buffer << ' ' << log.userinfo.username << ' ' << log.userinfo.station_id;
+
+    if (m_compact) {
+        m_buffer
+            << " eventrate=" << log.mean_eventrate
+            << " eventrate_stddev=" << log.stddev_eventrate
+            << " time_acc=" << log.mean_time_acc
+            << " pulselength=" << log.mean_pulselength
+            << " incoming=" << log.incoming
+            << " ublox_counter_progess=" << log.ublox_counter_progress
+            << " deadtime_factor=" << log.deadtime;
+        m_link.publish(m_buffer.str());
+        return;
+    }
+
+    const std::size_t name { m_buffer.size() };
+
+    publish_value(name, "eventrate", log.mean_eventrate);
+    publish_value(name, "eventrate_stddev", log.stddev_eventrate);
+    publish_value(name, "time_acc", log.mean_time_acc);
+    publish_value(name, "pulselength", log.mean_pulselength);
+    publish_value(name, "incoming", log.incoming);
+    publish_value(name, "ublox_counter_progess", log.ublox_counter_progress);
+    publish_value(name, "deadtime_factor", log.deadtime);
 }
 
 template <>
@@ -151,34 +222,32 @@ void mqtt<event_t>::get(event_t event)
     }
 
     const std::int64_t cluster_coinc_time = event.data.end - event.data.start;
-    guid uuid { event.data.hash, static_cast<std::uint64_t>(event.data.start) };
+    const std::string uuid { guid { event.data.hash, static_cast<std::uint64_t>(event.data.start) }.to_string() };
     for (auto& evt : event.events) {
-        location_t loc = evt.location;
-        // calculate the geohash up to 5 digits, this should avoid a precise tracking of the detector location
-        std::string geohash = coordinate::hash<double>::from_geodetic(coordinate::geodetic<double> { loc.lon * units::degree, loc.lat * units::degree }, loc.max_geohash_length);
-        message_constructor message { ' ' };
-        message.add_field(uuid.to_string()); // UUID for the L1Event
-        std::stringstream ss;
-        ss << std::setfill('0') << std::setw(sizeof(evt.hash) * 2) << std::hex << (evt.hash | 0);
-        message.add_field(ss.str()); // the hashed detector id
-        message.add_field(geohash); // the geohash of the detector's location
-        message.add_field(std::to_string(evt.time_acc)); // station's time accuracy
-        message.add_field(std::to_string(event.n())); // event multiplicity (coinc level)
-        message.add_field(std::to_string(cluster_coinc_time)); // total time span of the event (last - first)
-        message.add_field(std::to_string(evt.start - event.data.start)); // relative time of the station within the event (referred to first detector hit)
-        message.add_field(std::to_string(evt.ublox_counter)); // the station's hardware event counter (16bit)
-        message.add_field(std::to_string(evt.duration())); // the pulse length of the station for the hit contributing to this event
-        message.add_field(std::to_string(evt.gnss_time_grid)); // the time grid to which the station was synced at the moment of the event
-        message.add_field(std::to_string(evt.fix)); // if the station had a valid GNSS fix at the time of the event
-        message.add_field(std::to_string(evt.start)); // the timestamp of the stations hit
-        message.add_field(std::to_string(evt.utc)); //if the station uses utc
-        message.add_field(event.conflicting ? "conflicting" : "valid"); // if the event is conflicting or not
-        message.add_field(std::to_string(event.true_e)); // The number of true edges in the event graph
+        m_buffer.clear();
+        m_buffer
+            << uuid // UUID for the L1Event
+            << ' ';
+        m_buffer.append_hex(evt.hash); // the hashed detector id
+        m_buffer
+            << ' ' << evt.location.geohash // the geohash of the detector's location, calculated by the detector station when it moves
+            << ' ' << evt.time_acc // station's time accuracy
+            << ' ' << event.n() // event multiplicity (coinc level)
+            << ' ' << cluster_coinc_time // total time span of the event (last - first)
+            << ' ' << (evt.start - event.data.start) // relative time of the station within the event (referred to first detector hit)
+            << ' ' << evt.ublox_counter // the station's hardware event counter (16bit)
+            << ' ' << evt.duration() // the pulse length of the station for the hit contributing to this event
+            << ' ' << evt.gnss_time_grid // the time grid to which the station was synced at the moment of the event
+            << ' ' << evt.fix // if the station had a valid GNSS fix at the time of the event
+            << ' ' << evt.start // the timestamp of the stations hit
+            << ' ' << evt.utc //if the station uses utc
+            << ' ' << (event.conflicting ? "conflicting" : "valid") // if the event is conflicting or not
+            << ' ' << event.true_e; // The number of true edges in the event graph
 
         if (m_detailed) {
-            m_link.publish(evt.user + "/" + evt.station_id, message.get_string());
+            m_link.publish(topic(evt.user, evt.station_id), m_buffer.str());
         } else {
-            m_link.publish(message.get_string());
+            m_link.publish(m_buffer.str());
         }
     }
 }
@@ -186,37 +255,36 @@ void mqtt<event_t>::get(event_t event)
 template <>
 void mqtt<trigger::detector>::get(trigger::detector trigger)
 {
-    std::time_t time { std::chrono::system_clock::to_time_t(std::chrono::system_clock::now()) };
-    std::ostringstream stream {};
-    stream
-        << std::put_time(std::gmtime(&time), "%F_%H-%M-%S %Z")
+    start_message("%F_%H-%M-%S %Z");
+    m_buffer
         << ' ' << detector_status::to_string(trigger.status)
         << ' ' << detector_status::to_string(trigger.reason);
 
-    m_link.publish(trigger.userinfo.username + "/" + trigger.userinfo.station_id, stream.str());
+    m_link.publish(topic(trigger.userinfo.username, trigger.userinfo.station_id), m_buffer.str());
 }
 
 template <>
 void mqtt<detector_log_t>::get(detector_log_t log)
 {
-    std::time_t time { std::chrono::system_clock::to_time_t(std::chrono::system_clock::now()) };
-    std::ostringstream stream {};
-    stream << std::put_time(std::gmtime(&time), "%F_%H-%M-%S");
+    start_message();
+    const std::size_t time { m_buffer.size() };
+    const std::string& subtopic { topic(log.userinfo.username, log.userinfo.station_id) };
 
     while (!log.items.empty()) {
         detector_log_t::item item { log.get() };
-        auto constr { construct(stream.str(), item.name) };
+        m_buffer.truncate(time);
+        m_buffer << ' ' << item.name << ' ';
         if (item.type == detector_log_t::item::Type::Double) {
-            constr << item.value_d;
+            m_buffer << item.value_d;
         } else if (item.type == detector_log_t::item::Type::Int) {
-            constr << item.value_i;
+            m_buffer << item.value_i;
         } else {
-            constr << item.value_s;
+            m_buffer << item.value_s;
         }
         if (!item.unit.empty()) {
-            constr << item.unit;
+            m_buffer << ' ' << item.unit;
         }
-        m_link.publish(log.userinfo.username + "/" + log.userinfo.station_id, constr.str());
+        m_link.publish(subtopic, m_buffer.str());
     }
 }
 
@@ -0,0 +1,120 @@
+#ifndef SHAREDMEMORYSINK_H
+#define SHAREDMEMORYSINK_H
+
+#include "messages/detectorsummary.h"
+#include "messages/event.h"
+#include "messages/sharedrecord.h"
+
+#include "link/sharedring.h"
+
+#include <muonpi/sink/base.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <string>
+
+namespace muonpi::sink {
+
+template <typename T>
+/**
+ * @brief The shared_memory class
+ * Publishes messages into a link::shared_ring, using the fixed record layouts defined in messages/sharedrecord.h.
+ * Only coincidences are published. Of each coincidence at most shm::s_max_members contributing events are included.
+ */
+class shared_memory : public base<T> {
+public:
+    /**
+     * @brief shared_memory
+     * @param link The ring the records are published to
+     */
+    explicit shared_memory(link::shared_ring& link);
+
+    /**
+     * @brief get Reimplemented from sink::base
+     * @param message
+     */
+    void get(T message) override;
+
+private:
+    static void copy(char (&destination)[shm::s_name_length], const std::string& source);
+
+    link::shared_ring& m_link;
+};
+
+// +++++++++++++++++++++++++++++++
+// implementation part starts here
+// +++++++++++++++++++++++++++++++
+
+template <typename T>
+shared_memory<T>::shared_memory(link::shared_ring& link)
+    : m_link { link }
+{
+}
+
+template <typename T>
+void shared_memory<T>::copy(char (&destination)[shm::s_name_length], const std::string& source)
+{
+    const std::size_t length { std::min(source.size(), shm::s_name_length - 1) };
+    std::memcpy(destination, source.data(), length);
+    std::memset(destination + length, 0, shm::s_name_length - length);
+}
+
+template <>
+void shared_memory<event_t>::get(event_t event)
+{
+    if (event.n() < 2) {
+        return;
+    }
+
+    // the record is large, so it is kept in thread local storage instead of on the stack
+    static thread_local shm::event_record record {};
+
+    record.hash = event.data.hash;
+    record.start = event.data.start;
+    record.end = event.data.end;
+    record.n = static_cast<std::uint16_t>(event.n());
+    record.members = static_cast<std::uint16_t>(std::min(event.events.size(), shm::s_max_members));
+    record.conflicting = event.conflicting ? 1 : 0;
+    record.true_e = event.true_e;
+
+    for (std::size_t i { 0 }; i < record.members; i++) {
+        const auto& evt { event.events[i] };
+        auto& member { record.member[i] };
+        member.hash = evt.hash;
+        member.start = evt.start;
+        member.end = evt.end;
+        member.lat = evt.location.lat;
+        member.lon = evt.location.lon;
+        member.h = evt.location.h;
+        member.time_acc = evt.time_acc;
+        member.ublox_counter = evt.ublox_counter;
+        member.fix = evt.fix;
+        member.utc = evt.utc;
+        member.gnss_time_grid = evt.gnss_time_grid;
+        copy(member.user, evt.user);
+        copy(member.station_id, evt.station_id);
+    }
+    m_link.publish(&record);
+}
+
+template <>
+void shared_memory<detector_summary_t>::get(detector_summary_t log)
+{
+    shm::detector_summary_record record {};
+    record.time = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    record.mean_eventrate = log.mean_eventrate;
+    record.stddev_eventrate = log.stddev_eventrate;
+    record.mean_time_acc = log.mean_time_acc;
+    record.mean_pulselength = log.mean_pulselength;
+    record.deadtime = log.deadtime;
+    record.incoming = log.incoming;
+    record.ublox_counter_progress = log.ublox_counter_progress;
+    copy(record.user, log.userinfo.username);
+    copy(record.station_id, log.userinfo.station_id);
+    m_link.publish(&record);
+}
+
+} // namespace muonpi::sink
+
+#endif // SHAREDMEMORYSINK_H
@@ -0,0 +1,79 @@
+#ifndef DECODEPOOL_H
+#define DECODEPOOL_H
+
+#include <muonpi/sink/base.h>
+#include <muonpi/threadrunner.h>
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace muonpi::source {
+
+/**
+ * @brief The decode_pool class
+ * Distributes the decoding of incoming messages onto several worker threads.
+ * Tasks dispatched with the same shard key always run on the same worker, so their order is kept.
+ */
+class decode_pool {
+public:
+    using task = std::function<void()>;
+
+    /**
+     * @brief decode_pool
+     * @param workers The number of worker threads to start
+     */
+    explicit decode_pool(std::size_t workers);
+
+    ~decode_pool();
+
+    /**
+     * @brief dispatch Queue a task on the worker responsible for a shard key
+     * @param key The shard key, usually a hash identifying the originator of the message
+     * @param t The task to run
+     */
+    void dispatch(std::size_t key, task t);
+
+    /**
+     * @brief worker_for Get the index of the worker responsible for a shard key
+     * @param key The shard key
+     * @return the index, lower than size()
+     */
+    [[nodiscard]] auto worker_for(std::size_t key) const -> std::size_t;
+
+    /**
+     * @brief size The number of worker threads
+     */
+    [[nodiscard]] auto size() const -> std::size_t;
+
+    /**
+     * @brief threads Access the worker threads, so they can be supervised.
+     */
+    [[nodiscard]] auto threads() -> std::vector<std::reference_wrapper<thread_runner>>;
+
+    /**
+     * @brief forward_mutex Mutex to hold while handing decoded items to the sinks.
+     * The sinks of the sources were written for being called from the single mqtt callback thread.
+     */
+    [[nodiscard]] auto forward_mutex() -> std::mutex&;
+
+private:
+    class worker : public sink::threaded<task> {
+    public:
+        explicit worker(const std::string& name);
+
+        void get(task t) override;
+
+    protected:
+        [[nodiscard]] auto process(task t) -> int override;
+    };
+
+    std::vector<std::unique_ptr<worker>> m_workers {};
+
+    std::mutex m_forward_mutex {};
+};
+
+} // namespace muonpi::source
+
+#endif // DECODEPOOL_H
@@ -3,8 +3,14 @@
 
 #include "messages/detectorinfo.h"
 #include "messages/detectorlog.h"
+#include "messages/binaryevent.h"
 #include "messages/event.h"
+#include "messages/logkeys.h"
 #include "messages/userinfo.h"
+#include "source/decodepool.h"
+#include "source/statistics.h"
+#include "utility/hashtable.h"
+
 #include <muonpi/link/mqtt.h>
 
 #include <muonpi/source/base.h>
@@ -13,9 +19,12 @@
 #include <muonpi/utility.h>
 
 #include <algorithm>
-#include <map>
+#include <chrono>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <string_view>
+#include <vector>
 
 namespace muonpi::source {
 
@@ -27,16 +36,39 @@ class mqtt : public base<T> {
 public:
     struct configuration {
         int max_geohash_length {};
+        std::size_t max_buffer_size { 4096 }; //!< The maximum number of items which can be aggregated at the same time
+        std::chrono::system_clock::duration buffer_timeout { std::chrono::seconds { 10 } }; //!< The time after which an incomplete item gets removed from the buffer
+        bool binary { false }; //!< The messages use the compact binary format instead of the text protocol
+        std::size_t identity_cache_size { 16384 }; //!< The number of topics whose identity each decoding thread caches, should cover all active detectors
     };
     /**
      * @brief mqtt
      * @param subscriber The mqtt Topic this source should be subscribed to
+     * @param pool An optional decode pool. If given, messages get decoded on its workers instead of the mqtt callback thread.
      */
-    mqtt(sink::base<T>& sink, link::mqtt::subscriber& topic, configuration config);
+    mqtt(sink::base<T>& sink, link::mqtt::subscriber& topic, configuration config, decode_pool* pool = nullptr);
 
     ~mqtt() override;
 
-private:
+    /**
+     * @brief statistics Accesses the statistics of the aggregation buffer
+     * @return a reference to the buffer statistics. Safe to be read from other threads.
+     */
+    [[nodiscard]] auto statistics() const -> const buffer_statistics&;
+
+protected:
+    // identity and item_collector are accessible to derived classes, so the decoding can be measured without a subscriber
+    /**
+    * @brief Everything derived from the topic of a message. Cached per topic, so steady state messages don't need to rebuild it.
+    */
+    struct identity {
+        std::string topic {}; //!< The full topic, to verify cache hits
+        bool valid { false }; //!< The topic is one this source accepts messages from
+        bool l1data { false }; //!< The topic belongs to the l1data family
+        userinfo_t userinfo {};
+        std::size_t hash { 0 }; //!< The hashed site id, @see userinfo_t::hash
+    };
+
     /**
     * @brief Adapter base class for the collection of several logically connected, but timely distributed mqttItems
     */
@@ -60,12 +92,28 @@ private:
 
         /**
         * @brief add Tries to add a Message to the Item. The item chooses which messages to keep
+        * @param origin The resolved topic of the message
         * @param message The message to pass
         * @return result code
         */
-        [[nodiscard]] auto add(message_parser& topic, message_parser& message) -> ResultCode;
+        [[nodiscard]] auto add(const identity& origin, message_parser& message) -> ResultCode;
+
+        /**
+        * @brief add_binary Tries to add a message in the compact binary format to the Item.
+        * @param origin The resolved topic of the message
+        * @param payload The unparsed message content
+        * @return result code
+        */
+        [[nodiscard]] auto add_binary(const identity& origin, std::string_view payload) -> ResultCode;
+
+        /**
+        * @brief expire Gets called when the item exceeded its deadline in the buffer.
+        * @return Finished if the partially collected item should still be used, Abort otherwise
+        */
+        [[nodiscard]] auto expire() const -> ResultCode;
 
         userinfo_t user_info {};
+        std::size_t hash { 0 };
 
         const std::chrono::system_clock::time_point m_first_message { std::chrono::system_clock::now() };
 
@@ -77,19 +125,77 @@ private:
         configuration m_config {};
     };
 
+private:
+    /**
+    * @brief The part of the aggregation buffer owned by exactly one decoding thread
+    */
+    struct shard {
+        shard(std::size_t max_size, std::size_t identity_cache_size)
+            : buffer { max_size }
+            , identities { identity_cache_size }
+        {
+        }
+
+        hash_table<item_collector> buffer;
+        hash_table<identity> identities;
+        std::chrono::system_clock::time_point last_sweep { std::chrono::system_clock::now() };
+        std::size_t reported_size { 0 };
+    };
+
     /**
      * @brief process Processes one LogItem
      * @param msg The message to process
+     * @param buffer The buffer shard responsible for this message
      */
-    void process(const link::mqtt::message_t& msg);
+    void process(const link::mqtt::message_t& msg, shard& buffer);
 
-    [[nodiscard]] auto generate_hash(message_parser& topic, message_parser& message) -> std::size_t;
+    [[nodiscard]] auto generate_hash(const identity& origin, message_parser& message) -> std::size_t;
 
-    link::mqtt::subscriber& m_link;
+    /**
+     * @brief resolve Looks up the identity belonging to a topic, and creates it if it is not cached yet.
+     * @param buffer The buffer shard whose cache to use
+     * @param topic The topic of the message
+     * @return A reference to the identity, valid until the next call of resolve for this shard
+     */
+    [[nodiscard]] auto resolve(shard& buffer, const std::string& topic) -> const identity&;
+
+    /**
+     * @brief shard_key Determines which decoding thread is responsible for a message, without parsing it.
+     * All messages which end up in the same item_collector need to have the same shard key.
+     * @param msg The message to check
+     * @return The shard key
+     */
+    [[nodiscard]] static auto shard_key(const link::mqtt::message_t& msg) -> std::size_t;
+
+    /**
+     * @brief sweep Removes all items from the buffer which exceeded their deadline
+     * @param buffer The buffer shard to sweep
+     * @param now The current time
+     */
+    void sweep(shard& buffer, std::chrono::system_clock::time_point now);
 
-    std::map<std::size_t, item_collector> m_buffer {};
+    /**
+     * @brief update_size Updates the buffer statistics after a shard has changed
+     */
+    void update_size(shard& buffer);
+
+    /**
+     * @brief forward Forwards a finished item to the sink.
+     * When decoding on several threads, the calls of all sources sharing the pool are serialised, since the sinks expect to be called from a single thread.
+     */
+    void forward(T item);
+
+    link::mqtt::subscriber& m_link;
 
     configuration m_config {};
+
+    decode_pool* m_pool { nullptr };
+
+    static constexpr std::chrono::seconds s_sweep_interval { 1 };
+
+    std::vector<std::unique_ptr<shard>> m_shards {};
+
+    buffer_statistics m_statistics {};
 };
 
 // +++++++++++++++++++++++++++++++
@@ -120,39 +226,88 @@ template <typename T>
 void mqtt<T>::item_collector::reset()
 {
     user_info = userinfo_t {};
+    hash = 0;
     status = default_status;
 }
 
+template <typename T>
+auto mqtt<T>::item_collector::expire() const -> ResultCode
+{
+    return Abort;
+}
+
+template <>
+auto mqtt<detector_log_t>::item_collector::expire() const -> ResultCode
+{
+    // a log which stopped arriving midway still carries valid information
+    return item.items.empty() ? Abort : Finished;
+}
+
+template <typename T>
+auto mqtt<T>::item_collector::add_binary(const identity& /*origin*/, std::string_view /*payload*/) -> ResultCode
+{
+    return Error;
+}
+
 template <>
-auto mqtt<detector_info_t<location_t>>::item_collector::add(message_parser& /*topic*/, message_parser& message) -> ResultCode
+auto mqtt<event_t>::item_collector::add_binary(const identity& origin, std::string_view payload) -> ResultCode
+{
+    event_t::data_t data;
+    if (!binary_event::decode(payload, data)) {
+        return Error;
+    }
+    data.hash = origin.hash;
+    data.user = origin.userinfo.username;
+    data.station_id = origin.userinfo.station_id;
+
+    item = event_t { data };
+    status = 0;
+    return Finished;
+}
+
+template <>
+auto mqtt<detector_info_t<location_t>>::item_collector::add(const identity& /*origin*/, message_parser& message) -> ResultCode
 {
     if ((std::chrono::system_clock::now() - m_first_message) > std::chrono::seconds { 5 }) {
         return Reset;
     }
-    item.hash = user_info.hash();
+    item.hash = hash;
     item.userinfo = user_info;
+
+    const log_keys::entry* key { log_keys::find(message[1]) };
+    if (key == nullptr) {
+        return ResultCode::Aggregating;
+    }
     try {
-        if (message[1] == "geoHeightMSL") {
+        switch (key->key) {
+        case log_keys::id::geo_height_msl:
             item.item<location_t>().h = std::stod(message[2], nullptr);
             status &= ~1;
-        } else if (message[1] == "geoHorAccuracy") {
+            break;
+        case log_keys::id::geo_hor_accuracy:
             item.item<location_t>().h_acc = std::stod(message[2], nullptr);
             status &= ~2;
-        } else if (message[1] == "geoLatitude") {
+            break;
+        case log_keys::id::geo_latitude:
             item.item<location_t>().lat = std::stod(message[2], nullptr);
             status &= ~4;
-        } else if (message[1] == "geoLongitude") {
+            break;
+        case log_keys::id::geo_longitude:
             item.item<location_t>().lon = std::stod(message[2], nullptr);
             status &= ~8;
-        } else if (message[1] == "geoVertAccuracy") {
+            break;
+        case log_keys::id::geo_vert_accuracy:
             item.item<location_t>().v_acc = std::stod(message[2], nullptr);
             status &= ~16;
-        } else if (message[1] == "positionDOP") {
+            break;
+        case log_keys::id::position_dop:
             item.item<location_t>().dop = std::stod(message[2], nullptr);
             status &= ~32;
-        } else if (message[1] == "maxGeohashLength") {
+            break;
+        case log_keys::id::max_geohash_length:
             item.item<location_t>().max_geohash_length = std::stoi(message[2], nullptr);
-        } else {
+            break;
+        default:
             return ResultCode::Aggregating;
         }
     } catch (std::invalid_argument& e) {
@@ -167,12 +322,12 @@ auto mqtt<detector_info_t<location_t>>::item_collector::add(message_parser& /*to
 }
 
 template <>
-auto mqtt<event_t>::item_collector::add(message_parser& topic, message_parser& content) -> ResultCode
+auto mqtt<event_t>::item_collector::add(const identity& origin, message_parser& content) -> ResultCode
 {
-    if ((topic.size() < 4) || (content.size() < 7)) {
+    if (content.size() < 7) {
         return Error;
     }
-    if (topic[1] == "l1data") {
+    if (origin.l1data) {
         if (content.size() < 13) {
             return Error;
         }
@@ -183,8 +338,8 @@ auto mqtt<event_t>::item_collector::add(message_parser& topic, message_parser& c
         try {
             data.hash = std::stoul(content[1], nullptr, 16);
             n = std::stoul(content[4], nullptr);
-            data.user = topic[2];
-            data.station_id = topic[3];
+            data.user = origin.userinfo.username;
+            data.station_id = origin.userinfo.station_id;
             data.time_acc = static_cast<std::uint32_t>(std::stoul(content[3], nullptr));
             data.ublox_counter = static_cast<std::uint16_t>(std::stoul(content[7], nullptr));
             data.fix = static_cast<std::uint8_t>(std::stoul(content[10], nullptr));
@@ -193,7 +348,7 @@ auto mqtt<event_t>::item_collector::add(message_parser& topic, message_parser& c
             data.start = std::stoll(content[11], nullptr);
             data.end = std::stoll(content[8], nullptr) + data.start;
         } catch (std::invalid_argument& e) {
-            log::warning() << "Received exception: " << e.what() << "\n While converting '" << topic.get() << " " << content.get() << "'";
+            log::warning() << "Received exception: " << e.what() << "\n While converting '" << origin.topic << " " << content.get() << "'";
             return Error;
         }
         if (status == 0) {
@@ -223,18 +378,18 @@ auto mqtt<event_t>::item_collector::add(message_parser& topic, message_parser& c
             return Error;
         }
 
-        data.hash = user_info.hash();
+        data.hash = origin.hash;
         data.start = static_cast<std::int_fast64_t>(std::stold(content[0]) * 1e9);
         data.end = static_cast<std::int_fast64_t>(std::stold(content[1]) * 1e9);
-        data.user = topic[2];
-        data.station_id = user_info.station_id;
+        data.user = origin.userinfo.username;
+        data.station_id = origin.userinfo.station_id;
         data.time_acc = static_cast<std::uint32_t>(std::stoul(content[2], nullptr));
         data.ublox_counter = static_cast<std::uint16_t>(std::stoul(content[3], nullptr));
         data.fix = static_cast<std::uint8_t>(std::stoul(content[4], nullptr));
         data.utc = static_cast<std::uint8_t>(std::stoul(content[6], nullptr));
         data.gnss_time_grid = static_cast<std::uint8_t>(std::stoul(content[5], nullptr));
     } catch (std::invalid_argument& e) {
-        log::warning() << "Received exception: " << e.what() << "\n While converting '" << topic.get() << " " << content.get() << "'";
+        log::warning() << "Received exception: " << e.what() << "\n While converting '" << origin.topic << " " << content.get() << "'";
         return Error;
     } catch (...) {
         return Error;
@@ -248,7 +403,7 @@ auto mqtt<event_t>::item_collector::add(message_parser& topic, message_parser& c
 }
 
 template <>
-auto mqtt<detector_log_t>::item_collector::add(message_parser& /*topic*/, message_parser& message) -> ResultCode
+auto mqtt<detector_log_t>::item_collector::add(const identity& /*origin*/, message_parser& message) -> ResultCode
 {
     if (item.items.empty()) {
         item.log_id = message[0];
@@ -256,75 +411,10 @@ auto mqtt<detector_log_t>::item_collector::add(message_parser& /*topic*/, messag
     } else if ((std::chrono::system_clock::now() - m_first_message) > std::chrono::seconds { 5 }) {
         return Commit;
     }
-    // clang-format off
-    static const std::map<std::string, detector_log_t::item::Type> mapping {
-          {"UBX_HW_Version"       , detector_log_t::item::Type::String}
-        , {"UBX_Prot_Version"     , detector_log_t::item::Type::String}
-        , {"UBX_SW_Version"       , detector_log_t::item::Type::String}
-        , {"hardwareVersionString", detector_log_t::item::Type::String}
-        , {"softwareVersionString", detector_log_t::item::Type::String}
-        , {"maxGeohashLength"     , detector_log_t::item::Type::String}
-        , {"uniqueId"             , detector_log_t::item::Type::String}
-        , {"geoHash"              , detector_log_t::item::Type::String}
-
-        , {"gainSwitch"           , detector_log_t::item::Type::Int}
-        , {"polaritySwitch1"      , detector_log_t::item::Type::Int}
-        , {"polaritySwitch2"      , detector_log_t::item::Type::Int}
-        , {"preampSwitch1"        , detector_log_t::item::Type::Int}
-        , {"preampSwitch2"        , detector_log_t::item::Type::Int}
-        , {"systemNrCPUs"         , detector_log_t::item::Type::Int}
-
-        , {"geoHeightMSL"         , detector_log_t::item::Type::Double}
-        , {"geoHorAccuracy"       , detector_log_t::item::Type::Double}
-        , {"geoLatitude"          , detector_log_t::item::Type::Double}
-        , {"geoLongitude"         , detector_log_t::item::Type::Double}
-        , {"geoVertAccuracy"      , detector_log_t::item::Type::Double}
-        , {"positionDOP"          , detector_log_t::item::Type::Double}
-        , {"RXBufUsage"           , detector_log_t::item::Type::Double}
-        , {"TXBufUsage"           , detector_log_t::item::Type::Double}
-        , {"adcSamplingTime"      , detector_log_t::item::Type::Double}
-        , {"antennaPower"         , detector_log_t::item::Type::Double}
-        , {"antennaStatus"        , detector_log_t::item::Type::Double}
-        , {"biasDAC"              , detector_log_t::item::Type::Double}
-        , {"biasSwitch"           , detector_log_t::item::Type::Double}
-        , {"calib_coeff2"         , detector_log_t::item::Type::Double}
-        , {"calib_coeff3"         , detector_log_t::item::Type::Double}
-        , {"calib_rsense"         , detector_log_t::item::Type::Double}
-        , {"calib_vdiv"           , detector_log_t::item::Type::Double}
-        , {"clockBias"            , detector_log_t::item::Type::Double}
-        , {"clockDrift"           , detector_log_t::item::Type::Double}
-        , {"fixStatus"            , detector_log_t::item::Type::Double}
-        , {"freqAccuracy"         , detector_log_t::item::Type::Double}
-        , {"ibias"                , detector_log_t::item::Type::Double}
-        , {"jammingLevel"         , detector_log_t::item::Type::Double}
-        , {"maxCNR"               , detector_log_t::item::Type::Double}
-        , {"maxRXBufUsage"        , detector_log_t::item::Type::Double}
-        , {"meanGeoHeightMSL"     , detector_log_t::item::Type::Double}
-        , {"preampAGC"            , detector_log_t::item::Type::Double}
-        , {"preampNoise"          , detector_log_t::item::Type::Double}
-        , {"rateAND"              , detector_log_t::item::Type::Double}
-        , {"rateXOR"              , detector_log_t::item::Type::Double}
-        , {"sats"                 , detector_log_t::item::Type::Double}
-        , {"systemFreeMem"        , detector_log_t::item::Type::Double}
-        , {"systemFreeSwap"       , detector_log_t::item::Type::Double}
-        , {"systemLoadAvg"        , detector_log_t::item::Type::Double}
-        , {"systemUptime"         , detector_log_t::item::Type::Double}
-        , {"temperature"          , detector_log_t::item::Type::Double}
-        , {"thresh1"              , detector_log_t::item::Type::Double}
-        , {"thresh2"              , detector_log_t::item::Type::Double}
-        , {"timeAccuracy"         , detector_log_t::item::Type::Double}
-        , {"timeDOP"              , detector_log_t::item::Type::Double}
-        , {"ubloxUptime"          , detector_log_t::item::Type::Double}
-        , {"usedSats"             , detector_log_t::item::Type::Double}
-        , {"vbias"                , detector_log_t::item::Type::Double}
-        , {"vsense"               , detector_log_t::item::Type::Double}
-    };
-    // clang-format on
-
     detector_log_t::item::Type type { detector_log_t::item::Type::String };
 
-    if (mapping.count(message[1]) > 0) {
-        type = mapping.at(message[1]);
+    if (const log_keys::entry* key { log_keys::find(message[1]) }; key != nullptr) {
+        type = key->type;
     }
 
     std::string unit {};
@@ -349,13 +439,30 @@ auto mqtt<detector_log_t>::item_collector::add(message_parser& /*topic*/, messag
 }
 
 template <typename T>
-mqtt<T>::mqtt(sink::base<T>& sink, link::mqtt::subscriber& topic, configuration config)
+mqtt<T>::mqtt(sink::base<T>& sink, link::mqtt::subscriber& topic, configuration config, decode_pool* pool)
     : base<T> { sink }
     , m_link { topic }
     , m_config { std::move(config) }
+    , m_pool { pool }
 {
+    const std::size_t shards { (m_pool == nullptr) ? 1 : m_pool->size() };
+    for (std::size_t i { 0 }; i < shards; i++) {
+        // l1 events are sharded by their content, so each shard might see every topic and gets the whole identity cache
+        m_shards.emplace_back(std::make_unique<shard>(std::max<std::size_t>(m_config.max_buffer_size / shards, 1), std::max<std::size_t>(m_config.identity_cache_size, 1)));
+    }
+
+    if (m_pool == nullptr) {
+        topic.emplace_callback([this](const link::mqtt::message_t& message) {
+            process(message, *m_shards.front());
+        });
+        return;
+    }
     topic.emplace_callback([this](const link::mqtt::message_t& message) {
-        process(message);
+        const std::size_t key { shard_key(message) };
+        shard& buffer { *m_shards[m_pool->worker_for(key)] };
+        m_pool->dispatch(key, [this, message, &buffer] {
+            process(message, buffer);
+        });
     });
 }
 
@@ -363,77 +470,168 @@ template <typename T>
 mqtt<T>::~mqtt() = default;
 
 template <typename T>
-auto mqtt<T>::generate_hash(message_parser& topic, message_parser& /*message*/) -> std::size_t
+auto mqtt<T>::statistics() const -> const buffer_statistics&
+{
+    return m_statistics;
+}
+
+template <typename T>
+void mqtt<T>::sweep(shard& buffer, std::chrono::system_clock::time_point now)
 {
-    userinfo_t userinfo {};
-    userinfo.username = topic[2];
-    std::string site { topic[3] };
-    for (std::size_t i = 4; i < topic.size(); i++) {
-        site += "/" + topic[i];
+    if ((now - buffer.last_sweep) < s_sweep_interval) {
+        return;
     }
-    userinfo.station_id = site;
+    buffer.last_sweep = now;
 
-    return userinfo.hash();
+    m_statistics.expired += buffer.buffer.erase_if([&](std::size_t /*hash*/, item_collector& item) {
+        if ((now - item.m_first_message) < m_config.buffer_timeout) {
+            return false;
+        }
+        if ((item.expire() & item_collector::Finished) != 0) {
+            forward(std::move(item.item));
+        }
+        return true;
+    });
+    update_size(buffer);
+}
+
+template <typename T>
+void mqtt<T>::update_size(shard& buffer)
+{
+    // unsigned wrap around takes care of shrinking buffers
+    m_statistics.size += buffer.buffer.size() - buffer.reported_size;
+    buffer.reported_size = buffer.buffer.size();
+}
+
+template <typename T>
+void mqtt<T>::forward(T item)
+{
+    if (m_pool == nullptr) {
+        this->put(std::move(item));
+        return;
+    }
+    std::scoped_lock<std::mutex> lock { m_pool->forward_mutex() };
+    this->put(std::move(item));
+}
+
+template <typename T>
+auto mqtt<T>::shard_key(const link::mqtt::message_t& msg) -> std::size_t
+{
+    return std::hash<std::string> {}(msg.topic);
+}
+
+template <>
+auto mqtt<event_t>::shard_key(const link::mqtt::message_t& msg) -> std::size_t
+{
+    // the members of one l1 event arrive on the topics of the individual detectors, but share their first field
+    if (msg.topic.find("/l1data/") != std::string::npos) {
+        const std::string_view content { msg.content };
+        return std::hash<std::string_view> {}(content.substr(0, content.find(' ')));
+    }
+    return std::hash<std::string> {}(msg.topic);
+}
+
+template <typename T>
+auto mqtt<T>::generate_hash(const identity& origin, message_parser& /*message*/) -> std::size_t
+{
+    return origin.hash;
 }
 
 template <>
-auto mqtt<event_t>::generate_hash(message_parser& /*topic*/, message_parser& message) -> std::size_t
+auto mqtt<event_t>::generate_hash(const identity& /*origin*/, message_parser& message) -> std::size_t
 {
     return std::hash<std::string> {}(message[0]);
 }
 
 template <typename T>
-void mqtt<T>::process(const link::mqtt::message_t& msg)
+auto mqtt<T>::resolve(shard& buffer, const std::string& topic) -> const identity&
 {
-    message_parser topic { msg.topic, '/' };
-    message_parser content { msg.content, ' ' };
+    const std::size_t key { std::hash<std::string> {}(topic) };
+    if (const identity* cached { buffer.identities.find(key) }; (cached != nullptr) && (cached->topic == topic)) {
+        return *cached;
+    }
 
-    if ((topic.size() < 4) || (content.size() < 2)) {
+    identity resolved {};
+    resolved.topic = topic;
+
+    message_parser parser { topic, '/' };
+    if ((parser.size() >= 4) && (parser[2] != "") && (parser[2] != "cluster")) {
+        resolved.valid = true;
+        resolved.l1data = (parser[1] == "l1data");
+        resolved.userinfo.username = parser[2];
+        std::string site { parser[3] };
+        for (std::size_t i = 4; i < parser.size(); i++) {
+            site += "/" + parser[i];
+        }
+        resolved.userinfo.station_id = site;
+        resolved.hash = resolved.userinfo.hash();
+    }
+
+    // the cache is bounded, once it is full a single entry makes room, so more active topics than its size only lower the hit rate gradually
+    return *buffer.identities.emplace_evicting(key, std::move(resolved));
+}
+
+template <typename T>
+void mqtt<T>::process(const link::mqtt::message_t& msg, shard& buffer)
+{
+    const identity& origin { resolve(buffer, msg.topic) };
+
+    if (!origin.valid) {
         return;
     }
-    if ((topic[2] == "") || (topic[2] == "cluster")) {
+
+    if (m_config.binary) {
+        // binary messages are always complete and never need buffering
+        item_collector item;
+        if ((item.add_binary(origin, msg.content) & item_collector::Finished) != 0) {
+            forward(std::move(item.item));
+        }
         return;
     }
 
-    std::size_t hash { generate_hash(topic, content) };
+    message_parser content { msg.content, ' ' };
 
-    if ((m_buffer.size() > 0) && (m_buffer.find(hash) != m_buffer.end())) {
-        item_collector& item { m_buffer[hash] };
-        auto result_code { item.add(topic, content) };
+    if (content.size() < 2) {
+        return;
+    }
+
+    sweep(buffer, std::chrono::system_clock::now());
+
+    std::size_t hash { generate_hash(origin, content) };
+
+    if (item_collector* buffered { buffer.buffer.find(hash) }; buffered != nullptr) {
+        auto result_code { buffered->add(origin, content) };
         if ((result_code & item_collector::Finished) != 0) {
-            this->put(std::move(item.item));
-            m_buffer.erase(hash);
+            forward(std::move(buffered->item));
+            buffer.buffer.erase(hash);
         } else if ((result_code & item_collector::Abort) != 0) {
-            m_buffer.erase(hash);
+            buffer.buffer.erase(hash);
         } else {
             return;
         }
+        update_size(buffer);
         if ((result_code & item_collector::NewEpoch) == 0) {
             return;
         }
     }
 
-    userinfo_t userinfo {};
-    userinfo.username = topic[2];
-    std::string site { topic[3] };
-    for (std::size_t i = 4; i < topic.size(); i++) {
-        site += "/" + topic[i];
-    }
-    userinfo.station_id = site;
-
     item_collector item;
-    item.user_info = userinfo;
+    item.user_info = origin.userinfo;
+    item.hash = origin.hash;
     item.m_config = m_config;
-    auto value { item.add(topic, content) };
+    auto value { item.add(origin, content) };
     if ((value & item_collector::Finished) != 0) {
-        this->put(std::move(item.item));
+        forward(std::move(item.item));
     } else if ((value & item_collector::Aggregating) != 0) {
-        m_buffer.insert({ hash, item });
+        if (buffer.buffer.emplace(hash, std::move(item)) == nullptr) {
+            m_statistics.dropped++;
+        }
+        update_size(buffer);
     }
 }
 
 template <>
-void mqtt<link::mqtt::message_t>::process(const link::mqtt::message_t& msg)
+void mqtt<link::mqtt::message_t>::process(const link::mqtt::message_t& msg, shard& /*buffer*/)
 {
     put(link::mqtt::message_t { msg });
 }
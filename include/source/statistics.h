@@ -0,0 +1,22 @@
+#ifndef SOURCESTATISTICS_H
+#define SOURCESTATISTICS_H
+
+#include <atomic>
+#include <cstddef>
+
+namespace muonpi::source {
+
+/**
+ * @brief The buffer_statistics struct
+ * Describes the state of the aggregation buffer of a source.
+ * It is written by the thread the source runs in and may be read from any other thread.
+ */
+struct buffer_statistics {
+    std::atomic<std::size_t> size { 0 }; //!< The current number of entries in the buffer
+    std::atomic<std::size_t> expired { 0 }; //!< The number of entries removed since program start because they exceeded their deadline
+    std::atomic<std::size_t> dropped { 0 }; //!< The number of entries rejected since program start because the buffer was full
+};
+
+} // namespace muonpi::source
+
+#endif // SOURCESTATISTICS_H
@@ -5,6 +5,8 @@
 #include "messages/clusterlog.h"
 #include "messages/detectorstatus.h"
 #include "messages/event.h"
+#include "link/statistics.h"
+#include "source/statistics.h"
 
 #include <muonpi/sink/base.h>
 
@@ -15,11 +17,14 @@
 
 #include <muonpi/source/base.h>
 
+#include <array>
 #include <chrono>
 #include <cinttypes>
 #include <fstream>
+#include <functional>
 #include <map>
 #include <mutex>
+#include <unordered_map>
 #include <vector>
 
 namespace muonpi::supervision {
@@ -46,7 +51,7 @@ public:
     void time_status(std::chrono::milliseconds timebase, std::chrono::milliseconds timeout);
 
     /**
-     * @brief detector_status Update the status of one detector
+     * @brief detector_status Update the status of one detector. May be called from any thread.
      * @param hash The hashed detector identifier
      * @param status The new status of the detector
      */
@@ -68,8 +73,21 @@ public:
     /**
      * @brief add_thread Add a thread to supervise. If this thread quits or has an error state, the main event loop will stop.
      * @param thread Pointer to the thread to supervise
+     * @param store Whether the thread stores what the other threads deliver. It is only stopped once all other threads have finished.
      */
-    void add_thread(thread_runner& thread);
+    void add_thread(thread_runner& thread, bool store = false);
+
+    /**
+     * @brief add_source_buffer Add the statistics of a source buffer to supervise. Their values will be summed up in the cluster log.
+     * @param statistics Reference to the statistics object
+     */
+    void add_source_buffer(const source::buffer_statistics& statistics);
+
+    /**
+     * @brief add_database_queue Add the statistics of a database queue to supervise. Their values will be summed up in the cluster log.
+     * @param statistics Reference to the statistics object
+     */
+    void add_database_queue(const link::queue_statistics& statistics);
 
 protected:
     /**
@@ -81,7 +99,9 @@ protected:
     [[nodiscard]] auto post_run() -> int override;
 
 private:
-    std::map<std::size_t, detector_status::status> m_detectors;
+    std::unordered_map<std::size_t, detector_status::status> m_detectors;
+    std::array<std::size_t, detector_status::reliable + 1> m_status_count {}; //!< The number of detectors per status, indexed by the status
+    std::mutex m_detectors_mutex;
     std::chrono::milliseconds m_timeout {};
     std::chrono::milliseconds m_timebase {};
     std::chrono::system_clock::time_point m_start { std::chrono::system_clock::now() };
@@ -98,12 +118,17 @@ private:
 
     struct forward {
         thread_runner& runner;
+        bool store { false };
     };
 
     bool m_failure { false };
 
     std::vector<forward> m_threads;
 
+    std::vector<std::reference_wrapper<const source::buffer_statistics>> m_source_buffers;
+
+    std::vector<std::reference_wrapper<const link::queue_statistics>> m_database_queues;
+
     cluster_log_t m_current_data;
     std::mutex m_outgoing_mutex;
     std::chrono::system_clock::time_point m_last { std::chrono::system_clock::now() };
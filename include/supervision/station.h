@@ -11,9 +11,15 @@
 #include <muonpi/sink/base.h>
 #include <muonpi/source/base.h>
 
-#include <map>
+#include <array>
+#include <chrono>
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <queue>
+#include <set>
+#include <unordered_map>
+#include <vector>
 
 namespace muonpi {
 
@@ -33,6 +39,8 @@ public:
     struct configuration {
         std::string station_id;
         std::chrono::steady_clock::duration detectorsummary_interval;
+        std::string state_file {}; //!< The file to save the detector states to. If empty, the states are not saved.
+        std::chrono::steady_clock::duration state_interval {}; //!< The interval in which the detector states are saved.
     };
 
     /**
@@ -45,11 +53,12 @@ public:
     station(sink::base<detector_summary_t>& summary_sink, sink::base<trigger::detector>& trigger_sink, sink::base<event_t>& event_sink, sink::base<timebase_t>& timebase_sink, supervision::state& supervisor, configuration config);
 
     /**
-     * @brief detector_status Update the status of one detector
-     * @param hash The hashed detector identifier
+     * @brief detector_status Update the status of one detector.
+     * Gets called by the detector itself, while the lock of the shard containing it is held.
+     * @param detector The detector which changed its status
      * @param status The new status of the detector
      */
-    void on_detector_status(std::size_t hash, detector_status::status status, detector_status::reason reason);
+    void on_detector_status(detector_station& detector, detector_status::status status, detector_status::reason reason);
 
     /**
      * @brief get Reimplemented from sink::base
@@ -63,6 +72,20 @@ public:
      */
     void get(detector_info_t<location_t> detector_info) override;
 
+    /**
+     * @brief save_state Writes the state of all detectors to the configured state file.
+     * The file is written to a temporary file first and replaced afterwards, so an interrupted write does not damage an existing file.
+     * @return true if the state was written successfully
+     */
+    auto save_state() const -> bool;
+
+    /**
+     * @brief load_state Restores the detectors from the configured state file, if it exists.
+     * Detectors which are already known are not replaced.
+     * @return The number of restored detectors
+     */
+    auto load_state() -> std::size_t;
+
     /**
      * @brief get_stations Get the information for all detector station
      * @return
@@ -86,14 +109,66 @@ protected:
     [[nodiscard]] auto process() -> int override;
 
 private:
+    /**
+     * @brief One part of the detector registry. Each shard is guarded by its own lock,
+     * so events for different detectors and the periodic stepping don't need to wait for each other.
+     * The detectors are stored contiguously, the index maps their hash to the position.
+     * The schedule contains one entry per detector with the time at which it needs to be stepped next, the earliest one on top.
+     * The factors of all reliable detectors are kept sorted, so the largest one is available without scanning the detectors.
+     */
+    struct shard {
+        using deadline = std::pair<std::chrono::system_clock::time_point, std::size_t>;
+
+        mutable std::mutex mutex {};
+        std::vector<detector_station> detectors {};
+        std::unordered_map<std::size_t, std::size_t> index {};
+        std::priority_queue<deadline, std::vector<deadline>, std::greater<>> schedule {};
+        std::multiset<double> factors {};
+        std::unordered_map<std::size_t, std::multiset<double>::iterator> contributions {};
+
+        [[nodiscard]] auto find(std::size_t hash) -> detector_station*;
+        [[nodiscard]] auto find(std::size_t hash) const -> const detector_station*;
+
+        /**
+         * @brief erase Removes the detector at a position by moving the last detector into its place
+         * @param position The position of the detector to remove
+         */
+        void erase(std::size_t position);
+
+        /**
+         * @brief update_factor Updates the contribution of one detector to the factors
+         * @param hash The hash of the detector
+         * @param factor The current factor of the detector
+         * @param reliable Whether the detector is reliable, only reliable detectors contribute
+         */
+        void update_factor(std::size_t hash, double factor, bool reliable);
+
+        /**
+         * @brief largest_factor The largest factor among the reliable detectors in this shard
+         * @return The factor, 1.0 if there are no reliable detectors
+         */
+        [[nodiscard]] auto largest_factor() const -> double;
+    };
+
+    [[nodiscard]] auto shard_for(std::size_t hash) -> shard&;
+    [[nodiscard]] auto shard_for(std::size_t hash) const -> const shard&;
+
     supervision::state& m_supervisor;
 
-    std::map<std::size_t, std::unique_ptr<detector_station>> m_detectors {};
+    static constexpr std::size_t s_shards { 16 };
 
-    std::queue<std::size_t> m_delete_detectors {};
+    std::array<shard, s_shards> m_shards {};
 
     std::chrono::steady_clock::time_point m_last { std::chrono::steady_clock::now() };
 
+    static constexpr std::chrono::seconds s_timebase_interval { 1 };
+    std::int64_t m_timebase_factor { 0 };
+    std::chrono::steady_clock::time_point m_last_timebase {};
+
+    static constexpr std::uint32_t s_state_magic { 0x5453504D }; //!< "MPST"
+    static constexpr std::uint16_t s_state_version { 1 };
+    std::chrono::steady_clock::time_point m_last_state { std::chrono::steady_clock::now() };
+
     configuration m_config {};
 };
 
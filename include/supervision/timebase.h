@@ -29,7 +29,7 @@ public:
     void get(event_t event) override;
 
     /**
-     * @brief get Reimplemented from pipeline::base
+     * @brief get Reimplemented from pipeline::base. Only forwards the timebase if it differs from the last one forwarded.
      * @param tb
      */
     void get(timebase_t tb) override;
@@ -45,6 +45,8 @@ private:
     std::int_fast64_t m_end { 0 };
 
     std::chrono::system_clock::duration m_current { s_minimum };
+
+    timebase_t m_last {};
 };
 
 }
@@ -0,0 +1,163 @@
+#ifndef BINARYSTREAM_H
+#define BINARYSTREAM_H
+
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <type_traits>
+
+namespace muonpi::binary {
+
+/**
+ * @brief The writer class
+ * Writes arithmetic values and strings to a stream in a fixed little endian representation.
+ * Strings are prefixed by their length as 32 bit unsigned value.
+ */
+class writer {
+public:
+    explicit writer(std::ostream& out);
+
+    template <typename T>
+    void put(T value);
+
+    void put(const std::string& value);
+
+    /**
+     * @brief good Checks the state of the underlying stream
+     * @return true if all values were written successfully
+     */
+    [[nodiscard]] auto good() const -> bool;
+
+private:
+    std::ostream& m_out;
+};
+
+/**
+ * @brief The reader class
+ * Reads values which were written by the writer class.
+ * Once a read fails, all following reads return default constructed values and good() returns false.
+ */
+class reader {
+public:
+    /**
+     * @brief reader
+     * @param in The stream to read from
+     * @param max_string_length Strings longer than this are treated as a read error
+     */
+    explicit reader(std::istream& in, std::uint32_t max_string_length = s_max_string_length);
+
+    template <typename T>
+    [[nodiscard]] auto get() -> T;
+
+    /**
+     * @brief good Checks the state of the underlying stream
+     * @return true if all values were read successfully
+     */
+    [[nodiscard]] auto good() const -> bool;
+
+    /**
+     * @brief fail Marks the reader as failed, used when a value was read successfully but is implausible
+     */
+    void fail();
+
+private:
+    static constexpr std::uint32_t s_max_string_length { 4096 };
+
+    std::istream& m_in;
+    std::uint32_t m_max_string_length {};
+};
+
+// +++++++++++++++++++++++++++++++
+// implementation part starts here
+// +++++++++++++++++++++++++++++++
+
+namespace detail {
+    template <typename T>
+    using raw_t = std::conditional_t<sizeof(T) == 8, std::uint64_t, std::conditional_t<sizeof(T) == 4, std::uint32_t, std::conditional_t<sizeof(T) == 2, std::uint16_t, std::uint8_t>>>;
+}
+
+inline writer::writer(std::ostream& out)
+    : m_out { out }
+{
+}
+
+template <typename T>
+void writer::put(T value)
+{
+    static_assert(std::is_arithmetic_v<T> || std::is_enum_v<T>, "Only arithmetic and enum values can be written directly.");
+    using U = detail::raw_t<T>;
+    static_assert(sizeof(U) == sizeof(T));
+
+    U raw {};
+    std::memcpy(&raw, &value, sizeof(T));
+
+    char buffer[sizeof(T)] {};
+    for (std::size_t i { 0 }; i < sizeof(T); i++) {
+        buffer[i] = static_cast<char>(static_cast<std::uint8_t>(raw >> (8U * i)));
+    }
+    m_out.write(buffer, sizeof(T));
+}
+
+inline void writer::put(const std::string& value)
+{
+    put<std::uint32_t>(static_cast<std::uint32_t>(value.size()));
+    m_out.write(value.data(), static_cast<std::streamsize>(value.size()));
+}
+
+inline auto writer::good() const -> bool
+{
+    return m_out.good();
+}
+
+inline reader::reader(std::istream& in, std::uint32_t max_string_length)
+    : m_in { in }
+    , m_max_string_length { max_string_length }
+{
+}
+
+template <typename T>
+auto reader::get() -> T
+{
+    if constexpr (std::is_same_v<T, std::string>) {
+        const auto length { get<std::uint32_t>() };
+        if (!good() || (length > m_max_string_length)) {
+            fail();
+            return {};
+        }
+        std::string value(length, '\0');
+        m_in.read(value.data(), static_cast<std::streamsize>(length));
+        return good() ? value : std::string {};
+    } else {
+        static_assert(std::is_arithmetic_v<T> || std::is_enum_v<T>, "Only arithmetic and enum values can be read directly.");
+        using U = detail::raw_t<T>;
+        static_assert(sizeof(U) == sizeof(T));
+
+        char buffer[sizeof(T)] {};
+        if (!m_in.read(buffer, sizeof(T))) {
+            return {};
+        }
+        U raw { 0 };
+        for (std::size_t i { 0 }; i < sizeof(T); i++) {
+            raw |= static_cast<U>(static_cast<U>(static_cast<std::uint8_t>(buffer[i])) << (8U * i));
+        }
+        T value {};
+        std::memcpy(&value, &raw, sizeof(T));
+        return value;
+    }
+}
+
+inline auto reader::good() const -> bool
+{
+    return m_in.good();
+}
+
+inline void reader::fail()
+{
+    m_in.setstate(std::ios::failbit);
+}
+
+} // namespace muonpi::binary
+
+#endif // BINARYSTREAM_H
@@ -0,0 +1,243 @@
+#ifndef HASHTABLE_H
+#define HASHTABLE_H
+
+#include <cstddef>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace muonpi {
+
+/**
+ * @brief The hash_table class
+ * Open addressing hash table with linear probing for keys which are already hashed values.
+ * The slot storage is allocated once on construction and never grows, so the memory footprint is fixed.
+ * Deletion uses backward shifting, so no tombstones accumulate over time.
+ */
+template <typename T>
+class hash_table {
+public:
+    /**
+     * @brief hash_table
+     * @param max_size The maximum number of entries the table accepts.
+     */
+    explicit hash_table(std::size_t max_size);
+
+    /**
+     * @brief find Search for an entry
+     * @param key The hashed key to search for
+     * @return A pointer to the entry, nullptr if there is none.
+     */
+    [[nodiscard]] auto find(std::size_t key) -> T*;
+
+    /**
+     * @brief emplace Insert or replace an entry
+     * @param key The hashed key of the entry
+     * @param value The value to store
+     * @return A pointer to the stored entry, nullptr if the table is full.
+     */
+    auto emplace(std::size_t key, T value) -> T*;
+
+    /**
+     * @brief emplace_evicting Insert or replace an entry. If the table is full, one entry is evicted to make room.
+     * The evicted entry is the first one found from the home slot of the key on, which amounts to a random choice for hashed keys.
+     * @param key The hashed key of the entry
+     * @param value The value to store
+     * @return A pointer to the stored entry, nullptr only if the maximum size is 0.
+     */
+    auto emplace_evicting(std::size_t key, T value) -> T*;
+
+    /**
+     * @brief erase Remove an entry
+     * @param key The hashed key of the entry
+     * @return true if an entry was removed
+     */
+    auto erase(std::size_t key) -> bool;
+
+    /**
+     * @brief erase_if Remove all entries for which the predicate returns true
+     * @param predicate Callable with the signature bool(std::size_t key, T& value)
+     * @return The number of removed entries
+     */
+    template <typename Predicate>
+    auto erase_if(Predicate predicate) -> std::size_t;
+
+    /**
+     * @brief clear Remove all entries
+     */
+    void clear();
+
+    [[nodiscard]] auto size() const -> std::size_t;
+    [[nodiscard]] auto max_size() const -> std::size_t;
+    [[nodiscard]] auto empty() const -> bool;
+
+private:
+    struct slot {
+        std::size_t key {};
+        std::optional<T> value {};
+    };
+
+    [[nodiscard]] static auto capacity_for(std::size_t max_size) -> std::size_t;
+
+    [[nodiscard]] auto index_of(std::size_t key) const -> std::size_t;
+
+    void erase_at(std::size_t index);
+
+    std::size_t m_max_size {};
+    std::vector<slot> m_slots {};
+    std::size_t m_mask {};
+    std::size_t m_size { 0 };
+};
+
+// +++++++++++++++++++++++++++++++
+// implementation part starts here
+// +++++++++++++++++++++++++++++++
+
+template <typename T>
+hash_table<T>::hash_table(std::size_t max_size)
+    : m_max_size { max_size }
+    , m_slots(capacity_for(max_size))
+    , m_mask { m_slots.size() - 1 }
+{
+}
+
+template <typename T>
+auto hash_table<T>::capacity_for(std::size_t max_size) -> std::size_t
+{
+    // keep the load factor at or below 0.5, so there is always a free slot terminating the probe sequence
+    std::size_t capacity { 8 };
+    while (capacity < (max_size * 2)) {
+        capacity <<= 1U;
+    }
+    return capacity;
+}
+
+template <typename T>
+auto hash_table<T>::index_of(std::size_t key) const -> std::size_t
+{
+    for (std::size_t i { key & m_mask };; i = (i + 1) & m_mask) {
+        const slot& s { m_slots[i] };
+        if (!s.value.has_value() || (s.key == key)) {
+            return i;
+        }
+    }
+}
+
+template <typename T>
+auto hash_table<T>::find(std::size_t key) -> T*
+{
+    slot& s { m_slots[index_of(key)] };
+    if (!s.value.has_value()) {
+        return nullptr;
+    }
+    return &(*s.value);
+}
+
+template <typename T>
+auto hash_table<T>::emplace(std::size_t key, T value) -> T*
+{
+    slot& s { m_slots[index_of(key)] };
+    if (!s.value.has_value()) {
+        if (m_size >= m_max_size) {
+            return nullptr;
+        }
+        m_size++;
+        s.key = key;
+    }
+    s.value.emplace(std::move(value));
+    return &(*s.value);
+}
+
+template <typename T>
+auto hash_table<T>::emplace_evicting(std::size_t key, T value) -> T*
+{
+    if ((m_size >= m_max_size) && (m_size > 0) && !m_slots[index_of(key)].value.has_value()) {
+        std::size_t victim { key & m_mask };
+        while (!m_slots[victim].value.has_value()) {
+            victim = (victim + 1) & m_mask;
+        }
+        erase_at(victim);
+    }
+    return emplace(key, std::move(value));
+}
+
+template <typename T>
+auto hash_table<T>::erase(std::size_t key) -> bool
+{
+    const std::size_t index { index_of(key) };
+    if (!m_slots[index].value.has_value()) {
+        return false;
+    }
+    erase_at(index);
+    return true;
+}
+
+template <typename T>
+void hash_table<T>::erase_at(std::size_t index)
+{
+    m_slots[index].value.reset();
+    m_size--;
+
+    std::size_t hole { index };
+    for (std::size_t i { (index + 1) & m_mask }; m_slots[i].value.has_value(); i = (i + 1) & m_mask) {
+        const std::size_t home { m_slots[i].key & m_mask };
+        // entries whose home lies cyclically within (hole, i] have to stay where they are
+        const bool stays { (hole <= i) ? ((hole < home) && (home <= i)) : ((hole < home) || (home <= i)) };
+        if (stays) {
+            continue;
+        }
+        m_slots[hole].key = m_slots[i].key;
+        m_slots[hole].value.emplace(std::move(*m_slots[i].value));
+        m_slots[i].value.reset();
+        hole = i;
+    }
+}
+
+template <typename T>
+template <typename Predicate>
+auto hash_table<T>::erase_if(Predicate predicate) -> std::size_t
+{
+    std::size_t removed { 0 };
+    for (std::size_t i { 0 }; i < m_slots.size();) {
+        slot& s { m_slots[i] };
+        if (s.value.has_value() && predicate(s.key, *s.value)) {
+            erase_at(i);
+            removed++;
+            // an entry might have been shifted into this slot, so check it again
+            continue;
+        }
+        ++i;
+    }
+    return removed;
+}
+
+template <typename T>
+void hash_table<T>::clear()
+{
+    for (auto& s : m_slots) {
+        s.value.reset();
+    }
+    m_size = 0;
+}
+
+template <typename T>
+auto hash_table<T>::size() const -> std::size_t
+{
+    return m_size;
+}
+
+template <typename T>
+auto hash_table<T>::max_size() const -> std::size_t
+{
+    return m_max_size;
+}
+
+template <typename T>
+auto hash_table<T>::empty() const -> bool
+{
+    return m_size == 0;
+}
+
+} // namespace muonpi
+
+#endif // HASHTABLE_H
@@ -0,0 +1,219 @@
+#ifndef TEXTBUFFER_H
+#define TEXTBUFFER_H
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace muonpi {
+
+/**
+ * @brief The text_buffer class
+ * Reusable output buffer for the text sinks.
+ * Numbers are formatted with std::to_chars into the buffer directly, without streams or temporary strings.
+ * Clearing the buffer keeps its capacity, so once it has grown to the size of the longest message, formatting allocates no memory.
+ *
+ * A buffer is not thread safe. Each sink owns its own buffer, which is only used from the thread calling the sink.
+ */
+class text_buffer {
+public:
+    static constexpr int s_default_precision { 6 }; //!< The precision of floating point values, the same as the default of std::ostream
+    static constexpr int s_shortest { -1 }; //!< Formats floating point values with the shortest representation which reads back to the same value
+
+    /**
+     * @brief text_buffer
+     * @param capacity The initial capacity to reserve
+     */
+    explicit text_buffer(std::size_t capacity = s_default_capacity);
+
+    /**
+     * @brief clear Removes the content, but keeps the capacity
+     */
+    void clear();
+
+    /**
+     * @brief truncate Shortens the content, used to reuse a common prefix for several messages
+     * @param size The new size. If it is larger than the current size, the content is left unchanged.
+     */
+    void truncate(std::size_t size);
+
+    auto operator<<(char c) -> text_buffer&;
+
+    auto operator<<(std::string_view text) -> text_buffer&;
+
+    auto operator<<(const std::string& text) -> text_buffer&;
+
+    auto operator<<(const char* text) -> text_buffer&;
+
+    /**
+     * @brief operator<< Appends an integer or floating point value. Floating point values use the default precision.
+     */
+    template <typename T, typename = std::enable_if_t<std::is_arithmetic_v<T>>>
+    auto operator<<(T value) -> text_buffer&;
+
+    /**
+     * @brief append Appends a floating point value with a specific precision
+     * @param value The value to append
+     * @param precision The number of significant digits, or s_shortest
+     */
+    template <typename T>
+    auto append(T value, int precision) -> text_buffer&;
+
+    /**
+     * @brief append_hex Appends an unsigned value as zero padded lower case hexadecimal number
+     * @param value The value to append
+     * @param width The number of digits
+     */
+    auto append_hex(std::uint64_t value, std::size_t width = sizeof(std::uint64_t) * 2) -> text_buffer&;
+
+    /**
+     * @brief append_time Appends a UTC time
+     * @param time The time to append
+     * @param format The format as used by strftime
+     */
+    auto append_time(std::time_t time, const char* format) -> text_buffer&;
+
+    [[nodiscard]] auto str() const -> const std::string&;
+
+    [[nodiscard]] auto view() const -> std::string_view;
+
+    [[nodiscard]] auto size() const -> std::size_t;
+
+    [[nodiscard]] auto empty() const -> bool;
+
+private:
+    static constexpr std::size_t s_default_capacity { 512 };
+    static constexpr std::size_t s_number_length { 64 };
+
+    std::string m_data {};
+};
+
+// +++++++++++++++++++++++++++++++
+// implementation part starts here
+// +++++++++++++++++++++++++++++++
+
+inline text_buffer::text_buffer(std::size_t capacity)
+{
+    m_data.reserve(capacity);
+}
+
+inline void text_buffer::clear()
+{
+    m_data.clear();
+}
+
+inline void text_buffer::truncate(std::size_t size)
+{
+    m_data.resize(std::min(size, m_data.size()));
+}
+
+inline auto text_buffer::operator<<(char c) -> text_buffer&
+{
+    m_data += c;
+    return *this;
+}
+
+inline auto text_buffer::operator<<(std::string_view text) -> text_buffer&
+{
+    m_data.append(text.data(), text.size());
+    return *this;
+}
+
+inline auto text_buffer::operator<<(const std::string& text) -> text_buffer&
+{
+    m_data.append(text);
+    return *this;
+}
+
+inline auto text_buffer::operator<<(const char* text) -> text_buffer&
+{
+    m_data.append(text);
+    return *this;
+}
+
+template <typename T, typename>
+auto text_buffer::operator<<(T value) -> text_buffer&
+{
+    if constexpr (std::is_same_v<T, bool>) {
+        m_data += value ? '1' : '0';
+        return *this;
+    } else if constexpr (std::is_floating_point_v<T>) {
+        return append(value, s_default_precision);
+    } else {
+        char buffer[s_number_length];
+        const auto result { std::to_chars(buffer, buffer + s_number_length, value) };
+        m_data.append(buffer, result.ptr);
+        return *this;
+    }
+}
+
+template <typename T>
+auto text_buffer::append(T value, int precision) -> text_buffer&
+{
+    static_assert(std::is_floating_point_v<T>, "Only floating point values have a precision.");
+    char buffer[s_number_length];
+#if defined(__cpp_lib_to_chars)
+    const auto result { (precision == s_shortest)
+            ? std::to_chars(buffer, buffer + s_number_length, value)
+            : std::to_chars(buffer, buffer + s_number_length, value, std::chars_format::general, precision) };
+    m_data.append(buffer, result.ptr);
+#else
+    // older standard libraries have no floating point support in to_chars
+    const int length { std::snprintf(buffer, s_number_length, "%.*g", (precision == s_shortest) ? 17 : precision, static_cast<double>(value)) };
+    if (length > 0) {
+        m_data.append(buffer, std::min<std::size_t>(static_cast<std::size_t>(length), s_number_length - 1));
+    }
+#endif
+    return *this;
+}
+
+inline auto text_buffer::append_hex(std::uint64_t value, std::size_t width) -> text_buffer&
+{
+    constexpr static const char* digits { "0123456789abcdef" };
+    const std::size_t start { m_data.size() };
+    m_data.append(width, '0');
+    for (std::size_t i { m_data.size() }; (i > start) && (value != 0); i--) {
+        m_data[i - 1] = digits[value & 0x0FU];
+        value >>= 4U;
+    }
+    return *this;
+}
+
+inline auto text_buffer::append_time(std::time_t time, const char* format) -> text_buffer&
+{
+    std::tm utc {};
+    gmtime_r(&time, &utc);
+    char buffer[s_number_length];
+    const std::size_t length { std::strftime(buffer, s_number_length, format, &utc) };
+    m_data.append(buffer, length);
+    return *this;
+}
+
+inline auto text_buffer::str() const -> const std::string&
+{
+    return m_data;
+}
+
+inline auto text_buffer::view() const -> std::string_view
+{
+    return m_data;
+}
+
+inline auto text_buffer::size() const -> std::size_t
+{
+    return m_data.size();
+}
+
+inline auto text_buffer::empty() const -> bool
+{
+    return m_data.empty();
+}
+
+} // namespace muonpi
+
+#endif // TEXTBUFFER_H
@@ -1,9 +1,12 @@
+#include "messages/histogramepoch.h"
+
 #include <algorithm>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <iterator>
 #include <map>
+#include <set>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -20,6 +23,14 @@ public:
 
     void fill();
 
+    /**
+     * @brief fill Adds one pair of a binary histogram file
+     * @param file The file containing the pair
+     * @param pair The pair to add
+     * @return false if the histogram of the pair is damaged
+     */
+    [[nodiscard]] auto fill(const muonpi::epoch::reader& file, const muonpi::epoch::pair_entry& pair) -> bool;
+
 private:
     std::map<std::int32_t, std::uint32_t> m_entries {};
     std::string m_directory {};
@@ -35,6 +46,12 @@ private:
 
 void print_help(const boost::program_options::options_description& desc);
 
+/**
+ * @brief pair_directory The name of the directory of a station pair, as used by the text format
+ * @return An empty string if the pair refers to stations which are not in the file
+ */
+[[nodiscard]] auto pair_directory(const muonpi::epoch::reader& file, const muonpi::epoch::pair_entry& pair) -> std::string;
+
 auto main(int argc, const char* argv[]) -> int
 {
     namespace po = boost::program_options;
@@ -50,21 +67,44 @@ auto main(int argc, const char* argv[]) -> int
     }
     po::notify(options);
 
-    std::string last_directory {};
+    const std::string root { options.at("directory").as<std::string>() };
+    std::map<std::string, aggregator> aggregators {};
+    std::set<std::string> text_directories {};
 
-    for (const auto& p : std::filesystem::recursive_directory_iterator(options.at("directory").as<std::string>())) {
+    for (const auto& p : std::filesystem::recursive_directory_iterator(root)) {
         if (!p.is_regular_file()) {
             continue;
         }
+        if (p.path().extension() == ".epoch") {
+            const muonpi::epoch::reader file { p.path().string() };
+            if (!file.good()) {
+                std::cerr << "Could not read the histogram file '" << p.path().string() << "'\n";
+                return 1;
+            }
+            for (std::size_t i { 0 }; i < file.header().pairs; i++) {
+                const auto& pair { file.pair(i) };
+                const std::string name { pair_directory(file, pair) };
+                if (name.empty()) {
+                    std::cerr << "Damaged station pair in '" << p.path().string() << "'\n";
+                    return 1;
+                }
+                const std::string directory { (p.path().parent_path() / name).string() };
+                if (!aggregators.try_emplace(directory, directory).first->second.fill(file, pair)) {
+                    std::cerr << "Damaged histogram in '" << p.path().string() << "'\n";
+                    return 1;
+                }
+            }
+            continue;
+        }
         if (p.path().extension() != ".hist") {
             continue;
         }
-        auto current_directory = p.path().parent_path();
-        if (last_directory == current_directory) {
+        const std::string current_directory { p.path().parent_path().string() };
+        if (!text_directories.emplace(current_directory).second) {
             continue;
         }
 
-        aggregator agg { current_directory };
+        aggregator& agg { aggregators.try_emplace(current_directory, current_directory).first->second };
 
         if (!agg.find_files()) {
             std::cerr << "Could not find any histograms in the specified directory '" << current_directory << "'\n";
@@ -72,21 +112,40 @@ auto main(int argc, const char* argv[]) -> int
         }
 
         agg.fill();
+    }
+
+    for (auto& [directory, agg] : aggregators) {
         if (!agg.save()) {
             std::cerr << "Could not save data.\n";
             return 1;
         }
-
-        last_directory = current_directory;
     }
 }
 
 void print_help(const boost::program_options::options_description& desc)
 {
-    std::cerr << "aggregation searches a directory for histograms and aggregates them into a single histogram file.\n"
+    std::cerr << "aggregation searches a directory for histograms and aggregates them into a single histogram file per station pair.\n"
+              << "Both the text format and the binary histogram files are read.\n"
               << desc;
 }
 
+auto pair_directory(const muonpi::epoch::reader& file, const muonpi::epoch::pair_entry& pair) -> std::string
+{
+    if ((pair.first >= file.header().stations) || (pair.second >= file.header().stations)) {
+        return {};
+    }
+    std::string first_site { file.name(pair.first) };
+    std::string second_site { file.name(pair.second) };
+
+    std::replace(first_site.begin(), first_site.end(), '/', '-');
+    std::replace(second_site.begin(), second_site.end(), '/', '-');
+
+    if (file.station(pair.first).hash < file.station(pair.second).hash) {
+        return first_site + "_" + second_site;
+    }
+    return second_site + "_" + first_site;
+}
+
 aggregator::aggregator(std::string directory, std::string output_filename)
     : m_directory { std::move(directory) }
     , m_output_filename { std::move(output_filename) }
@@ -174,8 +233,33 @@ void aggregator::fill()
     }
 }
 
+auto aggregator::fill(const muonpi::epoch::reader& file, const muonpi::epoch::pair_entry& pair) -> bool
+{
+    std::vector<std::uint32_t> counts {};
+    if (!file.counts(pair, counts)) {
+        return false;
+    }
+    const std::int32_t min { pair.bin_width * -static_cast<std::int32_t>(counts.size() / 2) };
+    for (std::size_t i { 0 }; i < counts.size(); i++) {
+        if (counts[i] == 0) {
+            continue;
+        }
+        const std::int32_t lower { min + static_cast<std::int32_t>(i) * pair.bin_width };
+        m_entries[(lower + lower + pair.bin_width) / 2] += counts[i];
+    }
+    m_distance = pair.distance;
+    m_bin_width = static_cast<std::uint32_t>(pair.bin_width);
+    m_n += static_cast<std::uint32_t>(pair.total);
+    m_uptime += static_cast<std::uint32_t>(pair.uptime);
+    m_sample_time += static_cast<std::uint32_t>((file.header().end - file.header().start) / 60);
+    return true;
+}
+
 auto aggregator::save() -> bool
 {
+    if (!std::filesystem::exists(m_directory)) {
+        std::filesystem::create_directories(m_directory);
+    }
     std::string name { m_directory + "/" + std::string { m_output_filename } };
     std::string name_hist { name + ".hist" };
     std::string name_meta { name + ".meta" };
@@ -4,6 +4,7 @@
 #include "messages/clusterlog.h"
 #include "messages/detectorinfo.h"
 #include "messages/event.h"
+#include "messages/serialisation.h"
 #include "supervision/timebase.h"
 
 #include <muonpi/log.h>
@@ -11,17 +12,21 @@
 #include <muonpi/sink/base.h>
 #include <muonpi/source/base.h>
 
+#include <algorithm>
 #include <cinttypes>
+#include <filesystem>
+#include <fstream>
 #include <stack>
 
 namespace muonpi {
 
 constexpr std::chrono::duration s_timeout { std::chrono::milliseconds { 100 } };
 
-coincidence_filter::coincidence_filter(sink::base<event_t>& event_sink, supervision::state& supervisor)
+coincidence_filter::coincidence_filter(sink::base<event_t>& event_sink, supervision::state& supervisor, configuration config)
     : sink::threaded<event_t> { "muon::filter", s_timeout }
     , source::base<event_t> { event_sink }
     , m_supervisor { supervisor }
+    , m_config { std::move(config) }
 {
 }
 
@@ -37,8 +42,94 @@ void coincidence_filter::get(event_t event)
     threaded<event_t>::internal_get(event);
 }
 
+auto coincidence_filter::save_checkpoint() -> bool
+{
+    if (m_config.checkpoint_file.empty()) {
+        return false;
+    }
+    const auto now { std::chrono::system_clock::now() };
+    const std::string temporary { m_config.checkpoint_file + ".tmp" };
+    {
+        std::ofstream file { temporary, std::ios::binary | std::ios::trunc };
+        binary::writer out { file };
+        out.put<std::uint32_t>(s_checkpoint_magic);
+        out.put<std::uint16_t>(s_checkpoint_version);
+        out.put<std::int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(m_timeout).count());
+        out.put<std::uint32_t>(static_cast<std::uint32_t>(m_constructors.size()));
+        for (const auto& constructor : m_constructors) {
+            out.put<std::int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(constructor.elapsed(now)).count());
+            out.put<std::int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(constructor.timeout).count());
+            binary::put(out, constructor.event);
+        }
+        if (!out.good()) {
+            log::warning("filter") << "Could not write checkpoint to '" << temporary << "'";
+            return false;
+        }
+    }
+    std::error_code error {};
+    std::filesystem::rename(temporary, m_config.checkpoint_file, error);
+    if (error) {
+        log::warning("filter") << "Could not replace checkpoint file '" << m_config.checkpoint_file << "': " << error.message();
+        return false;
+    }
+    log::info("filter") << "Saved " << m_constructors.size() << " unfinished coincidences to '" << m_config.checkpoint_file << "'";
+    return true;
+}
+
+void coincidence_filter::restore_checkpoint()
+{
+    using namespace std::chrono;
+
+    m_restore_pending = false;
+    if (m_config.checkpoint_file.empty()) {
+        return;
+    }
+    std::ifstream file { m_config.checkpoint_file, std::ios::binary };
+    if (!file.is_open()) {
+        return;
+    }
+    binary::reader in { file };
+    if ((in.get<std::uint32_t>() != s_checkpoint_magic) || (in.get<std::uint16_t>() != s_checkpoint_version)) {
+        log::warning("filter") << "Ignoring checkpoint file '" << m_config.checkpoint_file << "' with unknown format";
+        return;
+    }
+    const nanoseconds timeout { in.get<std::int64_t>() };
+    const auto count { in.get<std::uint32_t>() };
+    if (!in.good() || (count > s_max_checkpoint_size)) {
+        log::warning("filter") << "Checkpoint file '" << m_config.checkpoint_file << "' is damaged";
+        return;
+    }
+
+    const auto now { system_clock::now() };
+    std::list<event_constructor> restored {};
+    for (std::uint32_t i { 0 }; i < count; i++) {
+        event_constructor constructor {};
+        const nanoseconds elapsed { in.get<std::int64_t>() };
+        constructor.timeout = duration_cast<system_clock::duration>(nanoseconds { in.get<std::int64_t>() });
+        binary::get(in, constructor.event);
+        if (!in.good()) {
+            log::warning("filter") << "Checkpoint file '" << m_config.checkpoint_file << "' is damaged, discarding it";
+            return;
+        }
+        constructor.rebase(now, duration_cast<system_clock::duration>(elapsed));
+        restored.emplace_back(std::move(constructor));
+    }
+
+    m_timeout = std::max(m_timeout, duration_cast<system_clock::duration>(timeout));
+    log::info("filter") << "Restored " << restored.size() << " unfinished coincidences from '" << m_config.checkpoint_file << "'";
+    m_constructors.splice(m_constructors.begin(), restored);
+
+    // the checkpoint is consumed, so a later crash does not restore the same coincidences twice
+    std::error_code error {};
+    std::filesystem::remove(m_config.checkpoint_file, error);
+}
+
 auto coincidence_filter::process() -> int
 {
+    if (m_restore_pending) {
+        restore_checkpoint();
+    }
+
     auto now { std::chrono::system_clock::now() };
 
     // +++ Send finished constructors off to the event sink
@@ -93,6 +184,10 @@ auto coincidence_filter::next_match(const event_t& event, std::list<event_constr
 
 auto coincidence_filter::process(event_t event) -> int
 {
+    if (m_restore_pending) {
+        restore_checkpoint();
+    }
+
     m_supervisor.process_event(event, true);
     const scope_guard guard { [&]() {
         m_supervisor.set_queue_size(m_constructors.size());
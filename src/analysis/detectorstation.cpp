@@ -1,13 +1,17 @@
 #include "analysis/detectorstation.h"
 #include "messages/event.h"
+#include "messages/serialisation.h"
 #include "supervision/state.h"
 
 #include "supervision/station.h"
 
+#include <muonpi/gnss.h>
 #include <muonpi/log.h>
 #include <muonpi/units.h>
 #include <muonpi/utility.h>
 
+#include <algorithm>
+
 namespace muonpi {
 
 constexpr double max_timing_error { 1000.0 * units::nanosecond }; //< max allowable timing error in nanoseconds
@@ -17,42 +21,59 @@ constexpr double stddev_factor { 0.75 };
 
 void detector_station::enable()
 {
-    set_status(detector_status::created);
+    // always announced, a restored status might equal the default one and would otherwise never be counted
+    m_status = m_initial_status;
+    m_stationsupervisor->on_detector_status(*this, m_status, detector_status::reason::miscellaneous);
 }
 
 detector_station::detector_station(const detector_info_t<location_t>& initial_log, supervision::station& stationsupervisor)
     : m_location { initial_log.get<location_t>() }
     , m_hash { initial_log.hash }
     , m_userinfo { initial_log.userinfo }
-    , m_stationsupervisor { stationsupervisor }
+    , m_stationsupervisor { &stationsupervisor }
 {
+    update_location(initial_log.get<location_t>());
 }
 
 auto detector_station::process(const event_t& event) -> bool
 {
     m_current_rate.increase_counter();
     m_mean_rate.increase_counter();
-    m_current_data.incoming++;
+    m_hot.incoming++;
+    m_hot.window_events++;
 
     const std::uint16_t current_ublox_counter = event.data.ublox_counter;
-    if (!m_initial) {
-        std::uint16_t difference { static_cast<uint16_t>(current_ublox_counter - m_last_ublox_counter) };
+    if (!m_hot.initial) {
+        std::uint16_t difference { static_cast<uint16_t>(current_ublox_counter - m_hot.last_ublox_counter) };
 
-        if (current_ublox_counter <= m_last_ublox_counter) {
-            difference = current_ublox_counter + (std::numeric_limits<std::uint16_t>::max() - m_last_ublox_counter);
+        if (current_ublox_counter <= m_hot.last_ublox_counter) {
+            difference = current_ublox_counter + (std::numeric_limits<std::uint16_t>::max() - m_hot.last_ublox_counter);
         }
-        m_current_data.ublox_counter_progress += difference;
+        m_hot.ublox_counter_progress += difference;
     } else {
-        m_initial = false;
+        m_hot.initial = false;
     }
-    m_last_ublox_counter = current_ublox_counter;
+    m_hot.last_ublox_counter = current_ublox_counter;
 
     double pulselength { static_cast<double>(event.data.end - event.data.start) };
     if ((pulselength > 0.0) && (pulselength < units::mega)) {
-        m_pulselength.add(pulselength);
+        m_hot.pulselength_sum += pulselength;
+        m_hot.pulselength_n++;
+    }
+    m_hot.time_acc_sum += event.data.time_acc;
+    m_hot.time_acc_n++;
+
+    m_hot.reliability_time_acc[m_hot.reliability_time_acc_next] = event.data.time_acc;
+    m_hot.reliability_time_acc_next = static_cast<std::uint8_t>((m_hot.reliability_time_acc_next + 1) % s_reliability_time_acc_length);
+    if (m_hot.reliability_time_acc_n < s_reliability_time_acc_length) {
+        m_hot.reliability_time_acc_n++;
+    }
+
+    // location and rate only change with logs and rate windows, so an event can only affect the reliability
+    // when it moves the time accuracy across the hysteresis band
+    if (!m_log_missing && (time_acc_band() != m_hot.time_acc_band)) {
+        check_reliability();
     }
-    m_time_acc.add(event.data.time_acc);
-    m_reliability_time_acc.add(event.data.time_acc);
 
     if (event.data.time_acc > (extreme_timing_error)) {
         set_status(detector_status::unreliable, detector_status::reason::time_accuracy_extreme);
@@ -64,14 +85,30 @@ auto detector_station::process(const event_t& event) -> bool
 void detector_station::process(const detector_info_t<location_t>& info)
 {
     m_last_log = std::chrono::system_clock::now();
-    m_location = info.get<location_t>();
+    m_log_missing = false;
+    update_location(info.get<location_t>());
     check_reliability();
 }
 
+void detector_station::update_location(location_t location)
+{
+    const bool moved { m_location.geohash.empty()
+        || (location.lat != m_location.lat)
+        || (location.lon != m_location.lon)
+        || (location.max_geohash_length != m_location.max_geohash_length) };
+    if (moved) {
+        // the geohash is limited in length, this should avoid a precise tracking of the detector location
+        location.geohash = coordinate::hash<double>::from_geodetic(coordinate::geodetic<double> { location.lon * units::degree, location.lat * units::degree }, location.max_geohash_length);
+    } else {
+        location.geohash = std::move(m_location.geohash);
+    }
+    m_location = std::move(location);
+}
+
 void detector_station::set_status(detector_status::status status, detector_status::reason reason)
 {
     if (m_status != status) {
-        m_stationsupervisor.on_detector_status(m_hash, status, reason);
+        m_stationsupervisor->on_detector_status(*this, status, reason);
     }
     m_status = status;
 }
@@ -88,59 +125,180 @@ auto detector_station::factor() const -> double
 
 void detector_station::check_reliability()
 {
-    constexpr static double hysteresis { 0.15 };
+    m_hot.time_acc_band = time_acc_band();
 
     const double loc_precision { m_location.dop * std::sqrt((m_location.h_acc * m_location.h_acc + m_location.v_acc * m_location.v_acc)) };
     const double f_location { loc_precision / max_location_error };
-    const double f_time { m_reliability_time_acc.mean() / max_timing_error };
+    const double f_time { reliability_time_acc() / max_timing_error };
     const double f_rate { m_mean_rate.stddev() / (m_mean_rate.mean() * stddev_factor) };
 
-    if (f_location > (1.0 + hysteresis)) {
+    if (f_location > (1.0 + s_reliability_hysteresis)) {
         set_status(detector_status::unreliable, detector_status::reason::location_precision);
-    } else if (f_time > (1.0 + hysteresis)) {
+    } else if (f_time > (1.0 + s_reliability_hysteresis)) {
         set_status(detector_status::unreliable, detector_status::reason::time_accuracy);
-    } else if (f_rate > (1.0 + hysteresis)) {
+    } else if (f_rate > (1.0 + s_reliability_hysteresis)) {
         set_status(detector_status::unreliable, detector_status::reason::rate_unstable);
-    } else if ((f_location < (1.0 - hysteresis)) && (f_time < (1.0 - hysteresis)) && ((f_rate < (1.0 - hysteresis)))) {
+    } else if ((f_location < (1.0 - s_reliability_hysteresis)) && (f_time < (1.0 - s_reliability_hysteresis)) && ((f_rate < (1.0 - s_reliability_hysteresis)))) {
         set_status(detector_status::reliable);
     }
 }
 
-void detector_station::step(const std::chrono::system_clock::time_point& now)
+auto detector_station::reliability_time_acc() const -> double
+{
+    if (m_hot.reliability_time_acc_n == 0) {
+        return 0.0;
+    }
+    double sum { 0.0 };
+    for (std::size_t i { 0 }; i < m_hot.reliability_time_acc_n; i++) {
+        sum += m_hot.reliability_time_acc[i];
+    }
+    return sum / static_cast<double>(m_hot.reliability_time_acc_n);
+}
+
+auto detector_station::time_acc_band() const -> std::int8_t
+{
+    const double f_time { reliability_time_acc() / max_timing_error };
+    if (f_time > (1.0 + s_reliability_hysteresis)) {
+        return 1;
+    }
+    if (f_time < (1.0 - s_reliability_hysteresis)) {
+        return -1;
+    }
+    return 0;
+}
+
+auto detector_station::step(const std::chrono::system_clock::time_point& now) -> std::chrono::system_clock::time_point
 {
     auto diff { now - std::chrono::system_clock::time_point { m_last_log } };
+    std::chrono::system_clock::time_point next { m_last_log + s_log_interval };
     if (diff > s_log_interval) {
+        m_log_missing = true;
         if (diff > s_offline_interval) {
             if (diff > s_quit_interval) {
                 set_status(detector_status::deleted, detector_status::reason::missed_log_interval);
-            } else {
-                set_status(detector_status::offline, detector_status::reason::missed_log_interval);
+                return now + s_step_resolution;
             }
-            return;
+            set_status(detector_status::offline, detector_status::reason::missed_log_interval);
+            // checked again every log interval, so a detector whose logs return resumes its rate windows promptly
+            return std::max(std::min(m_last_log + s_quit_interval, now + s_log_interval), now + s_step_resolution);
         }
         set_status(detector_status::unreliable, detector_status::reason::missed_log_interval);
-
-    } else {
-        check_reliability();
+        next = m_last_log + s_offline_interval;
     }
 
-    if (m_current_rate.step(now)) {
+    if ((now >= m_next_rate_step) && m_current_rate.step(now)) {
+        m_next_rate_step = now + s_time_interval;
         m_mean_rate.step(now);
+
+        const std::chrono::duration<double> window { now - m_rate_window_start };
+        m_rate_history[m_rate_history_next] = (window.count() > 0.0) ? (static_cast<double>(m_hot.window_events) / window.count()) : 0.0;
+        m_rate_history_next = static_cast<std::uint8_t>((m_rate_history_next + 1) % s_history_length);
+        if (m_rate_history_n < s_history_length) {
+            m_rate_history_n++;
+        }
+        m_hot.window_events = 0;
+        m_rate_window_start = now;
+
         if (m_current_rate.mean() < (m_mean_rate.mean() - m_mean_rate.stddev())) {
             constexpr static double scale { 2.0 };
             m_factor = ((m_mean_rate.mean() - m_current_rate.mean()) / (m_mean_rate.stddev()) + 1.0) * scale;
         } else {
             m_factor = 1.0;
         }
+        if (!m_log_missing) {
+            check_reliability();
+        }
     }
+
+    // the rate measurement might not have reached its window boundary yet, in that case it gets retried shortly after
+    return std::max(std::min(next, m_next_rate_step), now + s_step_resolution);
+}
+
+void detector_station::save(binary::writer& out) const
+{
+    out.put<std::uint64_t>(m_hash);
+    binary::put(out, m_userinfo);
+    binary::put(out, m_location);
+
+    out.put<std::uint8_t>(static_cast<std::uint8_t>(m_status));
+    out.put<std::int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(m_last_log.time_since_epoch()).count());
+    out.put<double>(m_factor);
+
+    // both ring buffers are written starting with the oldest value
+    out.put<std::uint8_t>(m_rate_history_n);
+    for (std::size_t i { 0 }; i < m_rate_history_n; i++) {
+        out.put<double>(m_rate_history[(m_rate_history_next + s_history_length - m_rate_history_n + i) % s_history_length]);
+    }
+    out.put<std::uint8_t>(m_hot.reliability_time_acc_n);
+    for (std::size_t i { 0 }; i < m_hot.reliability_time_acc_n; i++) {
+        out.put<double>(m_hot.reliability_time_acc[(m_hot.reliability_time_acc_next + s_reliability_time_acc_length - m_hot.reliability_time_acc_n + i) % s_reliability_time_acc_length]);
+    }
+}
+
+auto detector_station::restore(binary::reader& in, supervision::station& stationsupervisor) -> std::optional<detector_station>
+{
+    detector_info_t<location_t> info {};
+    info.hash = in.get<std::uint64_t>();
+    binary::get(in, info.userinfo);
+    binary::get(in, info.item<location_t>());
+
+    const auto status { static_cast<detector_status::status>(in.get<std::uint8_t>()) };
+    const std::chrono::system_clock::time_point last_log { std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds { in.get<std::int64_t>() }) };
+    const auto factor { in.get<double>() };
+
+    if (!in.good() || (status <= detector_status::deleted) || (status > detector_status::reliable)) {
+        return std::nullopt;
+    }
+
+    detector_station detector { info, stationsupervisor };
+    detector.m_last_log = last_log;
+    detector.m_log_missing = (std::chrono::system_clock::now() - last_log) > s_log_interval;
+    // a detector whose log messages stopped during the downtime can't be restored as reliable
+    detector.m_initial_status = (detector.m_log_missing && (status == detector_status::reliable)) ? detector_status::unreliable : status;
+    detector.m_factor = factor;
+
+    const auto rates { in.get<std::uint8_t>() };
+    if (rates > s_history_length) {
+        return std::nullopt;
+    }
+    for (std::size_t i { 0 }; i < rates; i++) {
+        const auto rate { in.get<double>() };
+        detector.m_current_rate.add(rate);
+        detector.m_mean_rate.add(rate);
+        detector.m_rate_history[i] = rate;
+    }
+    detector.m_rate_history_n = rates;
+    detector.m_rate_history_next = static_cast<std::uint8_t>(rates % s_history_length);
+
+    const auto time_accs { in.get<std::uint8_t>() };
+    if (time_accs > s_reliability_time_acc_length) {
+        return std::nullopt;
+    }
+    for (std::size_t i { 0 }; i < time_accs; i++) {
+        detector.m_hot.reliability_time_acc[i] = in.get<double>();
+    }
+    detector.m_hot.reliability_time_acc_n = time_accs;
+    detector.m_hot.reliability_time_acc_next = static_cast<std::uint8_t>(time_accs % s_reliability_time_acc_length);
+
+    if (!in.good()) {
+        return std::nullopt;
+    }
+    return detector;
 }
 
 auto detector_station::current_log_data() -> detector_summary_t
 {
     m_current_data.mean_eventrate = m_current_rate.mean();
     m_current_data.stddev_eventrate = m_current_rate.stddev();
-    m_current_data.mean_pulselength = m_pulselength.mean();
-    m_current_data.mean_time_acc = m_time_acc.mean();
+    // without events in the interval, the previous means are kept
+    if (m_hot.pulselength_n > 0) {
+        m_current_data.mean_pulselength = m_hot.pulselength_sum / static_cast<double>(m_hot.pulselength_n);
+    }
+    if (m_hot.time_acc_n > 0) {
+        m_current_data.mean_time_acc = m_hot.time_acc_sum / static_cast<double>(m_hot.time_acc_n);
+    }
+    m_current_data.incoming = m_hot.incoming;
+    m_current_data.ublox_counter_progress = m_hot.ublox_counter_progress;
 
     if (m_current_data.ublox_counter_progress == 0) {
         m_current_data.deadtime = 1.;
@@ -150,8 +308,12 @@ auto detector_station::current_log_data() -> detector_summary_t
     detector_summary_t log { m_current_data };
     log.hash = m_hash;
     log.userinfo = m_userinfo;
-    m_current_data.incoming = 0;
-    m_current_data.ublox_counter_progress = 0;
+    m_hot.incoming = 0;
+    m_hot.ublox_counter_progress = 0;
+    m_hot.pulselength_sum = 0.0;
+    m_hot.pulselength_n = 0;
+    m_hot.time_acc_sum = 0.0;
+    m_hot.time_acc_n = 0;
     return log;
 }
 
@@ -172,6 +334,11 @@ auto detector_station::location() const -> location_t
     return m_location;
 }
 
+auto detector_station::hash() const -> std::size_t
+{
+    return m_hash;
+}
+
 auto detector_status::to_string(status s) -> std::string
 {
     switch (s) {
@@ -17,4 +17,14 @@ auto event_constructor::timed_out(std::chrono::system_clock::time_point now) con
     return (now - m_start) >= timeout;
 }
 
+auto event_constructor::elapsed(std::chrono::system_clock::time_point now) const -> std::chrono::system_clock::duration
+{
+    return now - m_start;
+}
+
+void event_constructor::rebase(std::chrono::system_clock::time_point now, std::chrono::system_clock::duration elapsed)
+{
+    m_start = now - elapsed;
+}
+
 } // namespace muonpi
@@ -0,0 +1,256 @@
+#include "analysis/histogramstore.h"
+
+#include <muonpi/log.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace muonpi {
+
+histogram_store::histogram_store(std::string path, std::size_t bins, std::size_t capacity)
+    : m_path { std::move(path) }
+    , m_bins { bins }
+    , m_stride { ((s_alignment + 2 * bins * sizeof(std::uint32_t) + s_alignment - 1) / s_alignment) * s_alignment }
+{
+    static_assert(sizeof(slot_header) <= s_alignment);
+    static_assert(sizeof(file_header) <= s_alignment);
+
+    const int fd { open(m_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644) };
+    if (fd < 0) {
+        log::warning("histogram store") << "Could not open '" << m_path << "': " << std::strerror(errno) << ". Histograms will not survive a restart.";
+        m_size = s_alignment + capacity * m_stride;
+        map_anonymous();
+        m_header->capacity = capacity;
+        return;
+    }
+
+    // an existing store is resumed if it has the same layout, its capacity can only grow
+    file_header existing {};
+    const bool resume { (pread(fd, &existing, sizeof(existing), 0) == static_cast<ssize_t>(sizeof(existing)))
+        && (existing.magic == s_magic)
+        && (existing.version == s_version)
+        && (existing.bins == m_bins) };
+    if (resume) {
+        capacity = std::max<std::size_t>(capacity, existing.capacity);
+    } else if (ftruncate(fd, 0) != 0) {
+        log::warning("histogram store") << "Could not reset '" << m_path << "': " << std::strerror(errno);
+    }
+    m_size = s_alignment + capacity * m_stride;
+
+    void* memory { MAP_FAILED };
+    if (ftruncate(fd, static_cast<off_t>(m_size)) == 0) {
+        memory = mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (memory == MAP_FAILED) {
+        log::warning("histogram store") << "Could not map '" << m_path << "': " << std::strerror(errno) << ". Histograms will not survive a restart.";
+        map_anonymous();
+        m_header->capacity = capacity;
+        return;
+    }
+
+    m_persistent = true;
+    m_header = static_cast<file_header*>(memory);
+    m_slots = static_cast<std::byte*>(memory) + s_alignment;
+    if (!resume) {
+        m_header->bins = static_cast<std::uint32_t>(m_bins);
+        m_header->version = s_version;
+        m_header->magic = s_magic;
+    } else {
+        recover();
+        log::info("histogram store") << "Resumed " << size() << " station pair histograms from '" << m_path << "'";
+    }
+    m_header->capacity = capacity;
+}
+
+void histogram_store::recover()
+{
+    const std::size_t standby { 1 - active() };
+    std::size_t cleared { 0 };
+    m_header->free = 0;
+    m_header->free_head = 0;
+    for (std::size_t slot { m_header->slots }; slot-- > 0;) {
+        auto* h { reinterpret_cast<slot_header*>(slot_at(slot)) };
+        if (h->used == 0) {
+            // the list is rebuilt, a release which was interrupted could have left it incomplete
+            clear(slot, 0);
+            clear(slot, 1);
+            h->next_free = m_header->free_head;
+            m_header->free_head = slot + 1;
+            m_header->free++;
+            continue;
+        }
+        if (h->total[standby] > 0) {
+            cleared++;
+        }
+        clear(slot, standby);
+    }
+    if (cleared > 0) {
+        log::warning("histogram store") << "Discarded the histograms of " << cleared << " station pairs from a sample whose save was interrupted";
+    }
+}
+
+histogram_store::~histogram_store()
+{
+    if (m_header == nullptr) {
+        return;
+    }
+    sync();
+    munmap(m_header, m_size);
+}
+
+void histogram_store::map_anonymous()
+{
+    void* memory { mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0) };
+    if (memory == MAP_FAILED) {
+        throw std::bad_alloc {};
+    }
+    m_header = new (memory) file_header {};
+    m_header->bins = static_cast<std::uint32_t>(m_bins);
+    m_slots = static_cast<std::byte*>(memory) + s_alignment;
+}
+
+auto histogram_store::allocate(std::uint64_t first, std::uint64_t second, float distance, std::int32_t bin_width) -> std::size_t
+{
+    std::size_t slot { s_invalid };
+    if (m_header->free_head > 0) {
+        slot = static_cast<std::size_t>(m_header->free_head - 1);
+        m_header->free_head = reinterpret_cast<const slot_header*>(slot_at(slot))->next_free;
+        m_header->free--;
+    } else if (m_header->slots < m_header->capacity) {
+        slot = static_cast<std::size_t>(m_header->slots);
+    } else {
+        return s_invalid;
+    }
+    auto* h { reinterpret_cast<slot_header*>(slot_at(slot)) };
+    h->first = std::min(first, second);
+    h->second = std::max(first, second);
+    h->distance = distance;
+    h->bin_width = bin_width;
+    h->last_online = 0;
+    h->uptime = 0;
+    h->online = 0;
+    h->next_free = 0;
+    // the slot only becomes part of the store once its description is complete
+    h->used = 1;
+    if (slot == m_header->slots) {
+        m_header->slots++;
+    }
+    return slot;
+}
+
+void histogram_store::release(std::size_t slot)
+{
+    auto* h { reinterpret_cast<slot_header*>(slot_at(slot)) };
+    clear(slot, 0);
+    clear(slot, 1);
+    h->used = 0;
+    h->next_free = m_header->free_head;
+    m_header->free_head = slot + 1;
+    m_header->free++;
+}
+
+auto histogram_store::used(std::size_t slot) const -> bool
+{
+    return reinterpret_cast<const slot_header*>(slot_at(slot))->used != 0;
+}
+
+void histogram_store::clear(std::size_t slot, std::size_t set)
+{
+    auto* slot_data { slot_at(slot) };
+    auto* h { reinterpret_cast<slot_header*>(slot_data) };
+    if (h->total[set] == 0) {
+        // untouched pages stay unallocated
+        return;
+    }
+    std::memset(slot_data + s_alignment + set * m_bins * sizeof(std::uint32_t), 0, m_bins * sizeof(std::uint32_t));
+    h->total[set] = 0;
+}
+
+auto histogram_store::header(std::size_t slot) const -> const slot_header&
+{
+    return *reinterpret_cast<const slot_header*>(slot_at(slot));
+}
+
+void histogram_store::set_uptime(std::size_t slot, std::uint8_t online, std::int32_t uptime, std::int64_t last_online)
+{
+    auto* h { reinterpret_cast<slot_header*>(slot_at(slot)) };
+    h->online = online;
+    h->uptime = uptime;
+    h->last_online = last_online;
+}
+
+auto histogram_store::counts(std::size_t slot, std::size_t set) const -> const std::uint32_t*
+{
+    return reinterpret_cast<const std::uint32_t*>(slot_at(slot) + s_alignment) + set * m_bins;
+}
+
+auto histogram_store::active() const -> std::size_t
+{
+    return m_header->active;
+}
+
+void histogram_store::set_active(std::size_t set)
+{
+    m_header->active = static_cast<std::uint32_t>(set);
+}
+
+auto histogram_store::sample_start() const -> std::int64_t
+{
+    return m_header->sample_start;
+}
+
+void histogram_store::set_sample_start(std::int64_t start)
+{
+    m_header->sample_start = start;
+}
+
+auto histogram_store::updated() const -> std::int64_t
+{
+    return m_header->updated;
+}
+
+void histogram_store::set_updated(std::int64_t time)
+{
+    m_header->updated = time;
+}
+
+auto histogram_store::size() const -> std::size_t
+{
+    return static_cast<std::size_t>(m_header->slots - m_header->free);
+}
+
+auto histogram_store::slots() const -> std::size_t
+{
+    return static_cast<std::size_t>(m_header->slots);
+}
+
+auto histogram_store::capacity() const -> std::size_t
+{
+    return static_cast<std::size_t>(m_header->capacity);
+}
+
+auto histogram_store::persistent() const -> bool
+{
+    return m_persistent;
+}
+
+void histogram_store::sync()
+{
+    if (!m_persistent) {
+        return;
+    }
+    if (msync(m_header, m_size, MS_SYNC) != 0) {
+        log::warning("histogram store") << "Could not sync '" << m_path << "': " << std::strerror(errno);
+    }
+}
+
+} // namespace muonpi
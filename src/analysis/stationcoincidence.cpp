@@ -1,5 +1,6 @@
 #include "analysis/stationcoincidence.h"
 
+#include "messages/histogramepoch.h"
 #include "supervision/station.h"
 
 #include <muonpi/gnss.h>
@@ -19,6 +20,14 @@ station_coincidence::station_coincidence(std::string data_directory, supervision
     , m_data_directory { std::move(data_directory) }
     , m_config { std::move(config) }
 {
+    std::error_code error {};
+    std::filesystem::create_directories(m_data_directory, error);
+    m_store = std::make_unique<histogram_store>(m_data_directory + "/histograms.state", s_bins, m_config.capacity);
+    if (m_store->sample_start() > 0) {
+        m_last_save = std::chrono::system_clock::time_point { std::chrono::seconds { m_store->sample_start() } };
+    } else {
+        m_store->set_sample_start(std::chrono::duration_cast<std::chrono::seconds>(m_last_save.time_since_epoch()).count());
+    }
     reset();
     start();
 }
@@ -27,7 +36,8 @@ auto station_coincidence::step() -> int
 {
     std::mutex mx;
     std::unique_lock<std::mutex> lock { mx };
-    m_condition.wait_for(lock, m_config.histogram_sample_time);
+    // a sample resumed from the histogram store is saved once its full duration has passed
+    m_condition.wait_for(lock, (m_last_save + m_config.histogram_sample_time) - std::chrono::system_clock::now());
     if (!m_quit) {
         save();
     }
@@ -37,43 +47,52 @@ auto station_coincidence::step() -> int
 auto station_coincidence::post_run() -> int
 {
     save();
+    {
+        std::scoped_lock<std::mutex> lock { m_mutex };
+        m_store->set_updated(std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+    }
+    m_store->sync();
     return 0;
 }
 
 void station_coincidence::get(event_t event)
 {
-    if ((event.n() < 2) || (m_saving)) {
+    if (event.n() < 2) {
         return;
     }
 
+    std::scoped_lock<std::mutex> lock { m_mutex };
+    m_store->set_updated(std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+
+    // each station is resolved once per event, not once per pair
+    m_event_indices.clear();
+    for (const auto& evt : event.events) {
+        m_event_indices.emplace_back(index_of(evt.hash));
+    }
+
     for (std::size_t i { 0 }; i < (event.n() - 1); i++) {
         const std::size_t first_h { event.events.at(i).hash };
-        auto condition_1 = [&](const auto& iterator) { return iterator.first.hash() == first_h; };
-        auto it_1 { std::find_if(m_stations.begin(), m_stations.end(), condition_1) };
-        std::size_t first { static_cast<std::size_t>(std::distance(m_stations.begin(), it_1)) };
-        if (it_1 == m_stations.end()) {
-            const auto& [userinfo, location] { m_stationsupervisor.get_station(first_h) };
-            add_station(userinfo, location);
-            first = m_stations.size() - 1;
-        }
+        const std::size_t first { m_event_indices[i] };
         const auto first_t { event.events.at(i).start };
         for (std::size_t j { i + 1 }; j < event.n(); j++) {
             const std::size_t second_h { event.events.at(j).hash };
-            auto condition_2 = [&](const auto& iterator) { return iterator.first.hash() == second_h; };
-            auto it_2 { std::find_if(m_stations.begin(), m_stations.end(), condition_2) };
-            std::size_t second { static_cast<std::size_t>(std::distance(m_stations.begin(), it_2)) };
-            if (it_2 == m_stations.end()) {
-                const auto& [userinfo, location] { m_stationsupervisor.get_station(second_h) };
-                add_station(userinfo, location);
-                second = m_stations.size() - 1;
-            }
+            const std::size_t second { m_event_indices[j] };
             const auto second_t { event.events.at(j).start };
 
             auto& pair { m_data.at(std::max(first, second), std::min(first, second)) };
+            if (pair.histograms == s_unallocated) {
+                if (pair.distance > s_maximum_distance) {
+                    continue;
+                }
+                allocate(pair);
+                if (pair.histograms == s_unallocated) {
+                    continue;
+                }
+            }
             if (second_h > first_h) {
-                pair.hist.add(static_cast<std::int32_t>(first_t - second_t));
+                m_store->add(pair.histograms, m_store->active(), static_cast<std::int32_t>(first_t - second_t));
             } else {
-                pair.hist.add(static_cast<std::int32_t>(second_t - first_t));
+                m_store->add(pair.histograms, m_store->active(), static_cast<std::int32_t>(second_t - first_t));
             }
         }
     }
@@ -81,12 +100,12 @@ void station_coincidence::get(event_t event)
 
 void station_coincidence::get(trigger::detector trig)
 {
-    auto condition_1 = [&](const auto& iterator) { return iterator.first.hash() == trig.hash; };
-    auto it_1 { std::find_if(m_stations.begin(), m_stations.end(), condition_1) };
-    if (it_1 == m_stations.end()) {
+    std::scoped_lock<std::mutex> lock { m_mutex };
+    const auto it { m_index.find(trig.hash) };
+    if (it == m_index.end()) {
         return;
     }
-    std::size_t index { static_cast<std::size_t>(std::distance(m_stations.begin(), it_1)) };
+    const std::size_t index { it->second };
 
     m_data.iterate(index, [&](data_t& data) {
         switch (trig.status) {
@@ -105,6 +124,7 @@ void station_coincidence::get(trigger::detector trig)
         default:
             return;
         }
+        store_uptime(data);
     });
 }
 
@@ -124,8 +144,118 @@ void station_coincidence::save()
 
     m_last_save = now;
     log::debug("coincidence analysis") << "Saving histogram data.";
-    m_saving = true;
 
+    std::vector<std::pair<userinfo_t, location_t>> current_stations {};
+    std::vector<sample_t> samples {};
+    std::size_t standby {};
+    {
+        // only the active histograms are swapped here, so filling continues while the sample is written
+        std::scoped_lock<std::mutex> lock { m_mutex };
+        current_stations = m_stations;
+        samples.reserve(m_data.data().size());
+        standby = m_store->active();
+        m_store->set_active(1 - standby);
+        m_store->set_sample_start(std::chrono::duration_cast<std::chrono::seconds>(now.time_since_epoch()).count());
+        m_store->set_updated(std::chrono::duration_cast<std::chrono::seconds>(now.time_since_epoch()).count());
+        for (auto& data : m_data.data()) {
+            if (data.online == 2) {
+                data.uptime += std::chrono::duration_cast<std::chrono::minutes>(now - data.last_online).count();
+                data.last_online = now;
+            }
+            if (data.distance <= s_maximum_distance) {
+                sample_t sample { data.first, data.second, data.distance, data.bin_width, data.uptime };
+                if (data.histograms != s_unallocated) {
+                    const auto& header { m_store->header(data.histograms) };
+                    sample.slot = data.histograms;
+                    sample.bin_width = header.bin_width;
+                    sample.counts = m_store->counts(data.histograms, standby);
+                    sample.total = header.total[standby];
+                }
+                samples.emplace_back(sample);
+            }
+            data.uptime = 0;
+            store_uptime(data);
+        }
+        log::info("coincidence analysis") << "Saving " << samples.size() << " of " << m_data.data().size() << " station pairs, " << m_store->size() << " of " << m_store->capacity() << " histogram slots are allocated.";
+    }
+
+    if (m_config.text_format) {
+        save_text(filename, duration, current_stations, samples);
+    } else {
+        save_binary(filename, now - duration, now, current_stations, samples);
+    }
+
+    {
+        // pairs without coincidences during the whole sample give their slot back, they get a new one with their next coincidence
+        std::scoped_lock<std::mutex> lock { m_mutex };
+        for (auto& data : samples) {
+            if ((data.slot == s_unallocated) || (data.total > 0) || (m_store->header(data.slot).total[1 - standby] > 0)) {
+                continue;
+            }
+            const auto first { m_index.at(data.first) };
+            const auto second { m_index.at(data.second) };
+            m_data.at(std::max(first, second), std::min(first, second)).histograms = s_unallocated;
+            m_store->release(data.slot);
+            data.slot = s_unallocated;
+        }
+        // the stations of detached slots did not show up during a whole sample, so their counts are never saved
+        for (const auto& [stations, slot] : m_detached) {
+            m_store->release(slot);
+        }
+        m_detached.clear();
+        m_store_full = m_store_full && (m_store->size() >= m_store->capacity());
+    }
+
+    for (const auto& data : samples) {
+        if (data.slot != s_unallocated) {
+            m_store->clear(data.slot, standby);
+        }
+    }
+    m_store->sync();
+}
+
+void station_coincidence::save_binary(const std::string& filename, std::chrono::system_clock::time_point start, std::chrono::system_clock::time_point end, const std::vector<std::pair<userinfo_t, location_t>>& stations, const std::vector<sample_t>& samples)
+{
+    std::vector<epoch::writer::station> table {};
+    std::unordered_map<std::size_t, std::uint32_t> positions {};
+    table.reserve(stations.size());
+    for (const auto& [userinfo, location] : stations) {
+        positions.emplace(userinfo.hash(), static_cast<std::uint32_t>(table.size()));
+        table.emplace_back(epoch::writer::station { userinfo.hash(), userinfo.site_id(), location.lat, location.lon, location.h });
+    }
+
+    const std::string path { m_data_directory + "/" + epoch::file_name(filename) };
+    epoch::writer out {
+        path,
+        std::chrono::duration_cast<std::chrono::seconds>(start.time_since_epoch()).count(),
+        std::chrono::duration_cast<std::chrono::seconds>(end.time_since_epoch()).count(),
+        static_cast<std::uint32_t>(s_bins),
+        m_config.compress,
+        table
+    };
+
+    for (const auto& data : samples) {
+        const auto first { positions.find(data.first) };
+        const auto second { positions.find(data.second) };
+        if ((first == positions.end()) || (second == positions.end())) {
+            continue;
+        }
+        epoch::pair_entry entry {};
+        entry.first = first->second;
+        entry.second = second->second;
+        entry.distance = data.distance;
+        entry.bin_width = data.bin_width;
+        entry.uptime = data.uptime;
+        // the counts are written straight from the histogram store
+        out.add(entry, (data.total > 0) ? data.counts : nullptr);
+    }
+    if (!out.finish()) {
+        log::warning("coincidence analysis") << "Could not write histogram file '" << path << "'";
+    }
+}
+
+void station_coincidence::save_text(const std::string& filename, std::chrono::system_clock::duration duration, const std::vector<std::pair<userinfo_t, location_t>>& current_stations, const std::vector<sample_t>& samples)
+{
     std::ofstream stationfile { m_data_directory + "/" + filename + ".stations" };
 
     std::map<std::size_t, userinfo_t> stations {};
@@ -133,11 +263,11 @@ void station_coincidence::save()
 
     std::map<std::size_t, std::size_t> row_vector {};
 
-    for (const auto& [userinfo, location] : m_stations) {
+    for (const auto& [userinfo, location] : current_stations) {
         row_vector.emplace(userinfo.hash(), 0);
     }
 
-    for (const auto& [userinfo, location] : m_stations) {
+    for (const auto& [userinfo, location] : current_stations) {
         stations.emplace(userinfo.hash(), userinfo);
 
         station_matrix.emplace(userinfo.hash(), row_vector);
@@ -146,14 +276,10 @@ void station_coincidence::save()
     }
     stationfile.close();
 
-    for (auto& data : m_data.data()) {
-        if (data.online == 2) {
-            data.uptime += std::chrono::duration_cast<std::chrono::minutes>(now - data.last_online).count();
-            data.last_online = now;
-        }
-
-        station_matrix[data.first][data.second] = data.hist.integral();
-        station_matrix[data.second][data.first] = data.hist.integral();
+    for (const auto& data : samples) {
+        const std::size_t total { static_cast<std::size_t>(data.total) };
+        station_matrix[data.first][data.second] = total;
+        station_matrix[data.second][data.first] = total;
 
         std::ostringstream dir_stream {};
         dir_stream << m_data_directory << '/';
@@ -179,21 +305,23 @@ void station_coincidence::save()
         dir_stream << filename;
 
         std::ofstream histogram_file { dir_stream.str() + ".hist" };
-        for (const auto& bin : data.hist.qualified_bins()) {
-            histogram_file << ((bin.lower + bin.upper) / 2) << ' ' << bin.count << '\n';
+        if (data.counts != nullptr) {
+            const std::int32_t min { data.bin_width * -static_cast<std::int32_t>(s_bins * 0.5) };
+            for (std::size_t i { 0 }; i < s_bins; i++) {
+                const std::int32_t lower { min + static_cast<std::int32_t>(i) * data.bin_width };
+                histogram_file << ((lower + lower + data.bin_width) / 2) << ' ' << data.counts[i] << '\n';
+            }
         }
         histogram_file.close();
 
         std::ofstream metadata_file { dir_stream.str() + ".meta" };
         metadata_file
-            << "bin_width " << std::to_string(data.hist.width()) << " ns\n"
+            << "bin_width " << std::to_string(data.bin_width) << " ns\n"
             << "distance " << data.distance << " m\n"
-            << "total " << std::to_string(data.hist.integral()) << " 1\n"
+            << "total " << std::to_string(total) << " 1\n"
             << "uptime " << std::to_string(data.uptime) << " min\n"
             << "sample_time " << std::to_string(std::chrono::duration_cast<std::chrono::minutes>(duration).count()) << "min\n";
         metadata_file.close();
-        data.uptime = 0;
-        data.hist.reset();
     }
     std::ofstream adjacentfile { m_data_directory + "/" + filename + ".adj" };
     for (const auto& [hash, row] : row_vector) {
@@ -208,22 +336,92 @@ void station_coincidence::save()
         adjacentfile << '\n';
     }
     adjacentfile.close();
-    m_saving = false;
 }
 
 void station_coincidence::reset()
 {
+    std::scoped_lock<std::mutex> lock { m_mutex };
     m_stations.clear();
+    m_index.clear();
     m_data.reset();
+    m_detached.clear();
 
     for (const auto& [userinfo, location] : m_stationsupervisor.get_stations()) {
         add_station(userinfo, location);
     }
+
+    // pairs of a previous run continue to fill their slots
+    const auto now { std::chrono::system_clock::now() };
+    for (std::size_t slot { 0 }; slot < m_store->slots(); slot++) {
+        if (!m_store->used(slot)) {
+            continue;
+        }
+        const auto& header { m_store->header(slot) };
+        // the previous run was online until its last update, the time the processor was not running is no uptime
+        std::int32_t uptime { header.uptime };
+        if (header.online == 2) {
+            uptime += static_cast<std::int32_t>(std::max<std::int64_t>(0, m_store->updated() - header.last_online) / 60);
+        }
+        m_store->set_uptime(slot, header.online, uptime, std::chrono::duration_cast<std::chrono::seconds>(now.time_since_epoch()).count());
+
+        const auto first { m_index.find(header.first) };
+        const auto second { m_index.find(header.second) };
+        if ((first == m_index.end()) || (second == m_index.end()) || (first->second == second->second)) {
+            m_detached.emplace(std::make_pair(header.first, header.second), slot);
+            continue;
+        }
+        auto& pair { m_data.at(std::max(first->second, second->second), std::min(first->second, second->second)) };
+        pair.histograms = slot;
+        pair.online = header.online;
+        pair.uptime = header.uptime;
+        pair.last_online = now;
+    }
+}
+
+auto station_coincidence::index_of(std::size_t hash) -> std::size_t
+{
+    if (const auto it { m_index.find(hash) }; it != m_index.end()) {
+        return it->second;
+    }
+    const auto& [userinfo, location] { m_stationsupervisor.get_station(hash) };
+    add_station(userinfo, location);
+    return m_stations.size() - 1;
+}
+
+void station_coincidence::allocate(data_t& pair)
+{
+    const auto detached { m_detached.find(std::make_pair(std::min(pair.first, pair.second), std::max(pair.first, pair.second))) };
+    if (detached != m_detached.end()) {
+        // the pair only became known during this run, its uptime of the previous run is added
+        pair.histograms = detached->second;
+        pair.uptime += m_store->header(pair.histograms).uptime;
+        m_detached.erase(detached);
+        store_uptime(pair);
+        return;
+    }
+    pair.histograms = m_store->allocate(pair.first, pair.second, pair.distance, pair.bin_width);
+    if (pair.histograms == s_unallocated) {
+        if (!m_store_full) {
+            log::warning("coincidence analysis") << "The histogram store is full, no histograms are allocated for further station pairs until slots are released.";
+            m_store_full = true;
+        }
+        return;
+    }
+    store_uptime(pair);
+}
+
+void station_coincidence::store_uptime(const data_t& pair)
+{
+    if (pair.histograms == s_unallocated) {
+        return;
+    }
+    m_store->set_uptime(pair.histograms, pair.online, pair.uptime, std::chrono::duration_cast<std::chrono::seconds>(pair.last_online.time_since_epoch()).count());
 }
 
 void station_coincidence::add_station(const userinfo_t& userinfo, const location_t& location)
 {
     const auto x { m_data.increase() };
+    m_index[userinfo.hash()] = m_stations.size();
     m_stations.emplace_back(std::make_pair(userinfo, location));
     if (x > 0) {
         coordinate::geodetic<double> first { location.lat * units::degree, location.lon * units::degree, location.h * units::meter };
@@ -232,9 +430,7 @@ void station_coincidence::add_station(const userinfo_t& userinfo, const location
             const auto distance { coordinate::transformation<double, coordinate::WGS84>::straight_distance(first, { loc.lat * units::degree, loc.lon * units::degree, loc.h }) };
             const auto time_of_flight { distance / consts::c_0 };
             const std::int32_t bin_width { static_cast<std::int32_t>(std::clamp((2.0 * time_of_flight) / static_cast<double>(s_bins), 1.0, s_total_width / static_cast<double>(s_bins))) };
-            const std::int32_t min { bin_width * -static_cast<std::int32_t>(s_bins * 0.5) };
-            const std::int32_t max { bin_width * static_cast<std::int32_t>(s_bins * 0.5) };
-            m_data.emplace(x, y, { userinfo.hash(), user.hash(), static_cast<float>(distance), histogram_t { s_bins, min, max } });
+            m_data.emplace(x, y, { userinfo.hash(), user.hash(), static_cast<float>(distance), bin_width });
         }
     }
 }
@@ -9,14 +9,17 @@
 #include "messages/detectorlog.h"
 #include "messages/trigger.h"
 
+#include "source/decodepool.h"
 #include "source/mqtt.h"
 
+#include "sink/archive.h"
 #include "sink/ascii.h"
+#include "sink/columnar.h"
+#include "sink/sharedmemory.h"
 #include "sink/database.h"
 #include "sink/mqtt.h"
 
 #include <muonpi/exceptions.h>
-#include <muonpi/link/influx.h>
 #include <muonpi/link/mqtt.h>
 #include <muonpi/log.h>
 #include <muonpi/sink/base.h>
@@ -67,8 +70,14 @@ void application::shutdown(int exit_code)
 
 auto application::priv_run() -> int
 {
-    std::unique_ptr<link::influx> db_link { nullptr };
+    std::unique_ptr<link::influx_batch> db_link { nullptr };
     std::unique_ptr<link::mqtt> sink_mqtt_link { nullptr };
+    std::unique_ptr<link::archive> event_archive { nullptr };
+    std::unique_ptr<link::archive> detectorsummary_archive { nullptr };
+    std::unique_ptr<link::archive> trigger_archive { nullptr };
+    std::unique_ptr<link::columnar_archive> columnar_archive { nullptr };
+    std::unique_ptr<link::shared_ring> event_ring { nullptr };
+    std::unique_ptr<link::shared_ring> detectorsummary_ring { nullptr };
     std::unique_ptr<station_coincidence> stationcoincidence { nullptr };
 
     sink_ptr<trigger::detector> mqtt_trigger_sink { nullptr };
@@ -87,6 +96,15 @@ auto application::priv_run() -> int
     sink_ptr<detector_summary_t> ascii_detectorsummary_sink { nullptr };
     sink_ptr<trigger::detector> ascii_trigger_sink { nullptr };
 
+    sink_ptr<event_t> archive_event_sink { nullptr };
+    sink_ptr<detector_summary_t> archive_detectorsummary_sink { nullptr };
+    sink_ptr<trigger::detector> archive_trigger_sink { nullptr };
+
+    sink_ptr<event_t> columnar_event_sink { nullptr };
+
+    sink_ptr<event_t> shm_event_sink { nullptr };
+    sink_ptr<detector_summary_t> shm_detectorsummary_sink { nullptr };
+
     link::mqtt::configuration source_mqtt_config {};
     source_mqtt_config.host = m_config.get<std::string>("source_mqtt_host");
     source_mqtt_config.port = m_config.get<int>("source_mqtt_port");
@@ -128,20 +146,73 @@ auto application::priv_run() -> int
         collection_trigger_sink.emplace(*ascii_trigger_sink);
     }
 
+    if (const std::string archive_directory { m_config.get<std::string>("archive_directory") }; !archive_directory.empty()) {
+        link::archive::configuration archive_config {};
+        archive_config.directory = archive_directory;
+        archive_config.max_file_size = static_cast<std::size_t>(m_config.get<int>("archive_file_size")) * 1024U * 1024U;
+        archive_config.max_file_age = std::chrono::minutes { m_config.get<int>("archive_file_age") };
+        archive_config.buffer_size = static_cast<std::size_t>(m_config.get<int>("archive_buffer_size")) * 1024U;
+        archive_config.sync_interval = std::chrono::milliseconds { m_config.get<int>("archive_sync_interval") };
+
+        archive_config.prefix = "events";
+        event_archive = std::make_unique<link::archive>(archive_config);
+        archive_config.prefix = "detectorsummaries";
+        detectorsummary_archive = std::make_unique<link::archive>(archive_config);
+        archive_config.prefix = "triggers";
+        trigger_archive = std::make_unique<link::archive>(archive_config);
+
+        archive_event_sink = std::make_unique<sink::archive<event_t>>(*event_archive);
+        archive_detectorsummary_sink = std::make_unique<sink::archive<detector_summary_t>>(*detectorsummary_archive);
+        archive_trigger_sink = std::make_unique<sink::archive<trigger::detector>>(*trigger_archive);
+
+        collection_event_sink.emplace(*archive_event_sink);
+        collection_detectorsummary_sink.emplace(*archive_detectorsummary_sink);
+        collection_trigger_sink.emplace(*archive_trigger_sink);
+    }
+
+    if (const std::string columnar_directory { m_config.get<std::string>("columnar_directory") }; !columnar_directory.empty()) {
+        columnar_archive = std::make_unique<link::columnar_archive>(
+            link::columnar_archive::configuration {
+                columnar_directory,
+                static_cast<std::size_t>(m_config.get<int>("columnar_block_size")),
+                std::chrono::seconds { m_config.get<int>("columnar_flush_interval") } });
+
+        columnar_event_sink = std::make_unique<sink::columnar<event_t>>(*columnar_archive);
+        collection_event_sink.emplace(*columnar_event_sink);
+    }
+
+    if (const std::string shm_name { m_config.get<std::string>("shm_name") }; !shm_name.empty()) {
+        const auto slots { static_cast<std::size_t>(m_config.get<int>("shm_slots")) };
+        // each ring may only be written by one thread, the sinks of both rings run in different collections
+        event_ring = std::make_unique<link::shared_ring>(link::shared_ring::configuration { shm_name + "-events", slots }, shm::record_type::event, sizeof(shm::event_record));
+        detectorsummary_ring = std::make_unique<link::shared_ring>(link::shared_ring::configuration { shm_name + "-summaries", slots }, shm::record_type::detector_summary, sizeof(shm::detector_summary_record));
+
+        shm_event_sink = std::make_unique<sink::shared_memory<event_t>>(*event_ring);
+        shm_detectorsummary_sink = std::make_unique<sink::shared_memory<detector_summary_t>>(*detectorsummary_ring);
+
+        collection_event_sink.emplace(*shm_event_sink);
+        collection_detectorsummary_sink.emplace(*shm_detectorsummary_sink);
+    }
+
     if (!m_config.is_set("offline")) {
         const std::string sink_mqtt_base_path { m_config.get<std::string>("sink_mqtt_base_path") };
         mqtt_trigger_sink = std::make_unique<sink::mqtt<trigger::detector>>(sink_mqtt_link->publish(sink_mqtt_base_path + "trigger"));
         collection_trigger_sink.emplace(*mqtt_trigger_sink);
 
         if (!m_config.is_set("local")) {
-            link::influx::configuration influx_config {};
+            link::influx_batch::configuration influx_config {};
 
             influx_config.host = m_config.get<std::string>("influx_host");
             influx_config.database = m_config.get<std::string>("influx_database");
             influx_config.login.username = m_config.get<std::string>("influx_user");
             influx_config.login.password = m_config.get<std::string>("influx_password");
+            influx_config.batch_size = static_cast<std::size_t>(m_config.get<int>("influx_batch_size"));
+            influx_config.batch_interval = std::chrono::milliseconds { m_config.get<int>("influx_batch_interval") };
+            influx_config.gzip = m_config.get<bool>("influx_gzip");
+            influx_config.queue_size = static_cast<std::size_t>(m_config.get<int>("influx_queue_size"));
+            influx_config.spill_file = m_config.get<std::string>("influx_spill_file");
 
-            db_link = std::make_unique<link::influx>(influx_config);
+            db_link = std::make_unique<link::influx_batch>(influx_config);
 
             event_sink = std::make_unique<sink::database<event_t>>(*db_link);
             clusterlog_sink = std::make_unique<sink::database<cluster_log_t>>(*db_link);
@@ -155,8 +226,9 @@ auto application::priv_run() -> int
 
         } else {
             event_sink = std::make_unique<sink::mqtt<event_t>>(sink_mqtt_link->publish(sink_mqtt_base_path + "l1data"), true);
-            clusterlog_sink = std::make_unique<sink::mqtt<cluster_log_t>>(sink_mqtt_link->publish(sink_mqtt_base_path + "cluster"));
-            detectorsummary_sink = std::make_unique<sink::mqtt<detector_summary_t>>(sink_mqtt_link->publish(sink_mqtt_base_path + "cluster"));
+            const bool compact { m_config.get<bool>("sink_mqtt_compact") };
+            clusterlog_sink = std::make_unique<sink::mqtt<cluster_log_t>>(sink_mqtt_link->publish(sink_mqtt_base_path + "cluster"), false, compact);
+            detectorsummary_sink = std::make_unique<sink::mqtt<detector_summary_t>>(sink_mqtt_link->publish(sink_mqtt_base_path + "cluster"), false, compact);
             detectorlog_sink = std::make_unique<sink::mqtt<detector_log_t>>(sink_mqtt_link->publish(sink_mqtt_base_path + "log/"));
         }
         collection_event_sink.emplace(*event_sink);
@@ -170,7 +242,12 @@ auto application::priv_run() -> int
         supervision::state::configuration {
             m_config.get<std::string>("station_id"),
             std::chrono::minutes { m_config.get<int>("clusterlog_interval") } });
-    coincidence_filter coincidencefilter { collection_event_sink, *m_supervisor };
+    coincidence_filter coincidencefilter {
+        collection_event_sink,
+        *m_supervisor,
+        coincidence_filter::configuration {
+            m_config.get<std::string>("checkpoint_file") }
+    };
     supervision::timebase timebasesupervisor { coincidencefilter, coincidencefilter };
     supervision::station stationsupervisor {
         collection_detectorsummary_sink,
@@ -180,33 +257,62 @@ auto application::priv_run() -> int
         *m_supervisor,
         supervision::station::configuration {
             m_config.get<std::string>("station_id"),
-            std::chrono::minutes { m_config.get<int>("detectorsummary_interval") } }
+            std::chrono::minutes { m_config.get<int>("detectorsummary_interval") },
+            m_config.get<std::string>("state_file"),
+            std::chrono::minutes { m_config.get<int>("state_interval") } }
     };
+    stationsupervisor.load_state();
 
     const std::string source_mqtt_base_path { m_config.get<std::string>("source_mqtt_base_path") };
+    const auto source_buffer_size { static_cast<std::size_t>(m_config.get<int>("source_buffer_size")) };
+    const std::chrono::seconds source_buffer_timeout { m_config.get<int>("source_buffer_timeout") };
+    const auto source_identity_cache { static_cast<std::size_t>(m_config.get<int>("source_identity_cache")) };
+
+    std::unique_ptr<source::decode_pool> decodepool { nullptr };
+    if (m_config.get<int>("decode_workers") > 0) {
+        decodepool = std::make_unique<source::decode_pool>(static_cast<std::size_t>(m_config.get<int>("decode_workers")));
+    }
 
     source::mqtt<event_t> event_source {
         stationsupervisor,
         source_mqtt_link.subscribe(source_mqtt_base_path + "data/#"),
-        source::mqtt<event_t>::configuration { m_config.get<int>("geohash_length") }
+        source::mqtt<event_t>::configuration { m_config.get<int>("geohash_length"), source_buffer_size, source_buffer_timeout, false, source_identity_cache },
+        decodepool.get()
     };
     source::mqtt<event_t> l1_source {
         stationsupervisor,
         source_mqtt_link.subscribe(source_mqtt_base_path + "l1data/#"),
-        source::mqtt<event_t>::configuration { m_config.get<int>("geohash_length") }
+        source::mqtt<event_t>::configuration { m_config.get<int>("geohash_length"), source_buffer_size, source_buffer_timeout, false, source_identity_cache },
+        decodepool.get()
+    };
+    source::mqtt<event_t> binary_source {
+        stationsupervisor,
+        source_mqtt_link.subscribe(source_mqtt_base_path + "bdata/#"),
+        source::mqtt<event_t>::configuration { m_config.get<int>("geohash_length"), source_buffer_size, source_buffer_timeout, true, source_identity_cache },
+        decodepool.get()
     };
     source::mqtt<detector_info_t<location_t>> detector_location_source {
         stationsupervisor,
         source_mqtt_link.subscribe(source_mqtt_base_path + "log/#"),
         source::mqtt<detector_info_t<location_t>>::configuration {
-            m_config.get<int>("geohash_length") }
+            m_config.get<int>("geohash_length"),
+            source_buffer_size,
+            source_buffer_timeout,
+            false,
+            source_identity_cache },
+        decodepool.get()
     };
 
     source::mqtt<detector_log_t> detectorlog_source {
         collection_detectorlog_sink,
         source_mqtt_link.subscribe(source_mqtt_base_path + "log/#"),
         source::mqtt<detector_log_t>::configuration {
-            m_config.get<int>("geohash_length") }
+            m_config.get<int>("geohash_length"),
+            source_buffer_size,
+            source_buffer_timeout,
+            false,
+            source_identity_cache },
+        decodepool.get()
     };
 
     if (m_config.is_set("store_histogram") && m_config.get<bool>("store_histogram")) {
@@ -214,7 +320,10 @@ auto application::priv_run() -> int
             m_config.get<std::string>("histogram"),
             stationsupervisor,
             station_coincidence::configuration {
-                std::chrono::hours { m_config.get<int>("histogram_sample_time") } });
+                std::chrono::hours { m_config.get<int>("histogram_sample_time") },
+                m_config.get<bool>("histogram_text_format"),
+                m_config.get<bool>("histogram_compress"),
+                static_cast<std::size_t>(m_config.get<int>("histogram_capacity")) });
 
         collection_event_sink.emplace(*stationcoincidence);
         collection_trigger_sink.emplace(*stationcoincidence);
@@ -222,11 +331,34 @@ auto application::priv_run() -> int
         m_supervisor->add_thread(*stationcoincidence);
     }
 
+    m_supervisor->add_source_buffer(event_source.statistics());
+    m_supervisor->add_source_buffer(l1_source.statistics());
+    m_supervisor->add_source_buffer(binary_source.statistics());
+    m_supervisor->add_source_buffer(detector_location_source.statistics());
+    m_supervisor->add_source_buffer(detectorlog_source.statistics());
+
+    if (decodepool != nullptr) {
+        for (auto& thread : decodepool->threads()) {
+            m_supervisor->add_thread(thread);
+        }
+    }
     m_supervisor->add_thread(stationsupervisor);
     m_supervisor->add_thread(coincidencefilter);
     if (sink_mqtt_link != nullptr) {
         m_supervisor->add_thread(*sink_mqtt_link);
     }
+    if (db_link != nullptr) {
+        m_supervisor->add_database_queue(db_link->statistics());
+        m_supervisor->add_thread(*db_link, true);
+    }
+    if (event_archive != nullptr) {
+        m_supervisor->add_thread(*event_archive, true);
+        m_supervisor->add_thread(*detectorsummary_archive, true);
+        m_supervisor->add_thread(*trigger_archive, true);
+    }
+    if (columnar_archive != nullptr) {
+        m_supervisor->add_thread(*columnar_archive, true);
+    }
     m_supervisor->add_thread(source_mqtt_link);
     m_supervisor->add_thread(collection_event_sink);
     m_supervisor->add_thread(collection_detectorsummary_sink);
@@ -241,6 +373,10 @@ auto application::priv_run() -> int
     m_supervisor->start_synchronuos();
 
     const int status { m_supervisor->wait() };
+
+    stationsupervisor.save_state();
+    coincidencefilter.save_checkpoint();
+
     if (status == 0) {
         log::notice("app") << "Clean exit. bye.";
     } else {
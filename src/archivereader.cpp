@@ -0,0 +1,58 @@
+#include "messages/archiverecord.h"
+#include "messages/columnar.h"
+#include "utility/textbuffer.h"
+
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <string>
+
+#include <boost/program_options.hpp>
+
+namespace {
+constexpr std::int64_t s_ns_per_second { 1'000'000'000LL };
+
+void print_help(const boost::program_options::options_description& desc)
+{
+    std::cout << "archive-reader\n"
+              << "Prints the coincidences of a columnar archive written by the detector-network-processor.\n"
+              << "One line per contributing event:\n"
+              << "uuid n conflicting true_e user station_id hash start end time_acc ublox_counter fix utc gnss_time_grid lat lon h\n\n"
+              << desc << '\n';
+}
+} // namespace
+
+auto main(int argc, const char* argv[]) -> int
+{
+    namespace po = boost::program_options;
+
+    po::options_description desc("General options");
+    desc.add_options()("help,h", "produce help message")("directory,d", po::value<std::string>()->required(), "Directory of the archive")("from,f", po::value<std::int64_t>(), "Start of the time range. In seconds since epoch.")("to,t", po::value<std::int64_t>(), "End of the time range. In seconds since epoch.")("count,c", "Only print the number of coincidences");
+
+    po::variables_map options {};
+    po::store(po::parse_command_line(argc, argv, desc), options);
+    if (options.count("help")) {
+        print_help(desc);
+        return 0;
+    }
+    po::notify(options);
+
+    const std::int64_t from { options.count("from") ? options.at("from").as<std::int64_t>() * s_ns_per_second : std::numeric_limits<std::int64_t>::min() };
+    const std::int64_t to { options.count("to") ? options.at("to").as<std::int64_t>() * s_ns_per_second : std::numeric_limits<std::int64_t>::max() };
+    const bool count_only { options.count("count") > 0 };
+
+    muonpi::text_buffer buffer {};
+    const std::size_t found { muonpi::columnar::scan(options.at("directory").as<std::string>(), from, to, [&](const muonpi::event_t& event) {
+        if (count_only) {
+            return;
+        }
+        buffer.clear();
+        muonpi::archive_record::put(buffer, event);
+        std::cout.write(buffer.view().data(), static_cast<std::streamsize>(buffer.size()));
+    }) };
+
+    if (count_only) {
+        std::cout << found << '\n';
+    }
+    return 0;
+}
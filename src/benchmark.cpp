@@ -0,0 +1,446 @@
+#include "link/influxbatch.h"
+#include "messages/binaryevent.h"
+#include "sink/database.h"
+#include "sink/mqtt.h"
+#include "source/mqtt.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+namespace {
+using event_source = muonpi::source::mqtt<muonpi::event_t>;
+
+constexpr int s_unreachable_port { 9 }; //!< The links of the sink benchmark connect to the discard port, so nothing gets delivered
+
+/**
+ * @brief The decoder struct gives access to the message decoding of the mqtt source, without subscribing to a broker
+ */
+struct decoder : public event_source {
+    using event_source::identity;
+    using event_source::item_collector;
+};
+
+/**
+ * @brief measure Runs a benchmark once and prints its throughput
+ * @param name The name of the benchmark
+ * @param n The number of messages processed by the benchmark
+ * @param benchmark The benchmark, returns the number of messages it accepted
+ */
+template <typename F>
+void measure(const std::string& name, std::size_t n, F benchmark)
+{
+    const auto start { std::chrono::steady_clock::now() };
+    const std::size_t accepted { benchmark() };
+    const std::chrono::duration<double> elapsed { std::chrono::steady_clock::now() - start };
+
+    std::printf("%-28s %12.0f messages/s %10.1f ns/message %10zu accepted\n", name.c_str(), static_cast<double>(n) / elapsed.count(), elapsed.count() * 1e9 / static_cast<double>(n), accepted);
+}
+
+/**
+ * @brief generate Creates random event data in the value ranges detectors send
+ * @param n The number of events
+ */
+auto generate(std::size_t n) -> std::vector<muonpi::event_t::data_t>
+{
+    std::mt19937_64 engine { 1 };
+    std::uniform_int_distribution<std::int64_t> start { 1'600'000'000'000'000'000LL, 1'700'000'000'000'000'000LL };
+    std::uniform_int_distribution<std::int64_t> length { 50, 500 };
+    std::uniform_int_distribution<std::uint32_t> time_acc { 10, 200 };
+    std::uniform_int_distribution<std::uint16_t> counter {};
+
+    std::vector<muonpi::event_t::data_t> events(n);
+    for (auto& data : events) {
+        data.start = start(engine);
+        data.end = data.start + length(engine);
+        data.time_acc = time_acc(engine);
+        data.ublox_counter = counter(engine);
+        data.fix = 1;
+        data.utc = 1;
+        data.gnss_time_grid = 1;
+    }
+    return events;
+}
+
+/**
+ * @brief text_payload Formats event data the way detectors send it on the data topic
+ */
+auto text_payload(const muonpi::event_t::data_t& data) -> std::string
+{
+    constexpr std::int64_t ns_per_second { 1'000'000'000LL };
+    char payload[128] {};
+    std::snprintf(payload, sizeof(payload), "%lld.%09lld %lld.%09lld %u %u %u %u %u",
+        static_cast<long long>(data.start / ns_per_second), static_cast<long long>(data.start % ns_per_second),
+        static_cast<long long>(data.end / ns_per_second), static_cast<long long>(data.end % ns_per_second),
+        data.time_acc, static_cast<unsigned>(data.ublox_counter), static_cast<unsigned>(data.fix), static_cast<unsigned>(data.gnss_time_grid), static_cast<unsigned>(data.utc));
+    return payload;
+}
+
+/**
+ * @brief decoding Compares the decoding of text event messages to the decoding of binary event messages
+ * Only the per message work of the source is measured: splitting and converting the text message, or decoding the binary one.
+ * Topic resolution and buffering are the same for both formats.
+ * @param n The number of messages
+ */
+void decoding(std::size_t n)
+{
+    const auto events { generate(n) };
+    std::vector<std::string> text {};
+    std::vector<std::string> binary {};
+    text.reserve(n);
+    binary.reserve(n);
+    for (const auto& data : events) {
+        text.emplace_back(text_payload(data));
+        binary.emplace_back(muonpi::binary_event::encode(data));
+    }
+
+    decoder::identity origin {};
+    origin.topic = "muonpi/data/benchmark/detector";
+    origin.valid = true;
+    origin.userinfo.username = "benchmark";
+    origin.userinfo.station_id = "detector";
+    origin.hash = origin.userinfo.hash();
+
+    measure("decode text", n, [&] {
+        std::size_t accepted { 0 };
+        for (const auto& payload : text) {
+            muonpi::message_parser content { payload, ' ' };
+            decoder::item_collector item {};
+            if ((item.add(origin, content) & decoder::item_collector::Finished) != 0) {
+                accepted++;
+            }
+        }
+        return accepted;
+    });
+
+    measure("decode binary", n, [&] {
+        std::size_t accepted { 0 };
+        for (const auto& payload : binary) {
+            decoder::item_collector item {};
+            if ((item.add_binary(origin, payload) & decoder::item_collector::Finished) != 0) {
+                accepted++;
+            }
+        }
+        return accepted;
+    });
+}
+
+namespace legacy {
+// the event formatting of the sinks before they used text_buffer, kept as reference for the sink benchmark
+
+/**
+ * @brief mqtt_event Publishes a coincidence the way sink::mqtt<event_t> did, with message_constructor and std::to_string
+ */
+void mqtt_event(muonpi::link::mqtt::publisher& link, muonpi::event_t event, bool detailed)
+{
+    if (event.n() < 2) {
+        return;
+    }
+
+    const std::int64_t cluster_coinc_time = event.data.end - event.data.start;
+    muonpi::guid uuid { event.data.hash, static_cast<std::uint64_t>(event.data.start) };
+    for (auto& evt : event.events) {
+        muonpi::message_constructor message { ' ' };
+        message.add_field(uuid.to_string());
+        message.add_field(muonpi::hex_id(evt.hash));
+        message.add_field(evt.location.geohash);
+        message.add_field(std::to_string(evt.time_acc));
+        message.add_field(std::to_string(event.n()));
+        message.add_field(std::to_string(cluster_coinc_time));
+        message.add_field(std::to_string(evt.start - event.data.start));
+        message.add_field(std::to_string(evt.ublox_counter));
+        message.add_field(std::to_string(evt.duration()));
+        message.add_field(std::to_string(evt.gnss_time_grid));
+        message.add_field(std::to_string(evt.fix));
+        message.add_field(std::to_string(evt.start));
+        message.add_field(std::to_string(evt.utc));
+        message.add_field(event.conflicting ? "conflicting" : "valid");
+        message.add_field(std::to_string(event.true_e));
+
+        if (detailed) {
+            link.publish(evt.user + "/" + evt.station_id, message.get_string());
+        } else {
+            link.publish(message.get_string());
+        }
+    }
+}
+
+/**
+ * @brief The influx class collects line protocol records the way link::influx_batch did, with a separate string for every tag, field and record
+ */
+class influx {
+public:
+    struct tag {
+        std::string name {};
+        std::string value {};
+    };
+
+    template <typename T>
+    struct field {
+        std::string name {};
+        T value {};
+    };
+
+    class entry {
+    public:
+        entry(const std::string& measurement, influx& link)
+            : m_link { &link }
+            , m_tags { escape(measurement, ", ") }
+        {
+        }
+
+        auto operator<<(const tag& t) -> entry&
+        {
+            if (t.value.empty()) {
+                return *this;
+            }
+            m_tags += ',' + escape(t.name, ", =") + '=' + escape(t.value, ", =");
+            return *this;
+        }
+
+        template <typename T>
+        auto operator<<(const field<T>& f) -> entry&
+        {
+            std::string value {};
+            if constexpr (std::is_same_v<T, std::string>) {
+                value = "\"" + escape(f.value, "\"\\") + "\"";
+            } else if constexpr (std::is_same_v<T, bool>) {
+                value = f.value ? "true" : "false";
+            } else if constexpr (std::is_integral_v<T>) {
+                if constexpr (std::is_signed_v<T>) {
+                    value = std::to_string(static_cast<long long>(f.value)) + "i";
+                } else {
+                    value = std::to_string(static_cast<unsigned long long>(f.value)) + "i";
+                }
+            } else {
+                if (!std::isfinite(f.value)) {
+                    return *this;
+                }
+                char buffer[32] {};
+                std::snprintf(buffer, sizeof(buffer), "%.17g", static_cast<double>(f.value));
+                value = buffer;
+            }
+            if (!m_fields.empty()) {
+                m_fields += ',';
+            }
+            m_fields += escape(f.name, ", =") + "=" + value;
+            return *this;
+        }
+
+        [[nodiscard]] auto commit(std::int_fast64_t timestamp) -> bool
+        {
+            if (m_fields.empty()) {
+                return false;
+            }
+            m_link->append(m_tags + ' ' + m_fields + ' ' + std::to_string(timestamp) + '\n');
+            return true;
+        }
+
+    private:
+        influx* m_link { nullptr };
+        std::string m_tags {};
+        std::string m_fields {};
+    };
+
+    [[nodiscard]] auto measurement(const std::string& measurement) -> entry
+    {
+        return entry { measurement, *this };
+    }
+
+    [[nodiscard]] auto lines() const -> std::size_t
+    {
+        return m_lines;
+    }
+
+private:
+    [[nodiscard]] static auto escape(const std::string& value, const char* characters) -> std::string
+    {
+        std::string result {};
+        result.reserve(value.size());
+        for (const char c : value) {
+            if (std::strchr(characters, c) != nullptr) {
+                result += '\\';
+            }
+            result += c;
+        }
+        return result;
+    }
+
+    void append(std::string line)
+    {
+        std::scoped_lock<std::mutex> lock { m_mutex };
+        m_buffer += line;
+        m_lines++;
+    }
+
+    std::mutex m_mutex {};
+    std::string m_buffer {};
+    std::size_t m_lines { 0 };
+};
+
+/**
+ * @brief database_event Writes a coincidence the way sink::database<event_t> did
+ */
+void database_event(influx& link, muonpi::event_t event)
+{
+    using tag = influx::tag;
+    using std::int_fast64_t;
+
+    if (event.n() < 2) {
+        return;
+    }
+
+    const std::int64_t cluster_coinc_time = event.duration();
+    muonpi::guid uuid { event.data.hash, static_cast<std::uint64_t>(event.data.start) };
+    double plausibility { static_cast<double>(event.true_e) / (static_cast<double>(event.n() * event.n() - event.n()) * 0.5) };
+    for (auto& evt : event.events) {
+        if (!(link.measurement("L1Event")
+                << tag { "user", evt.user }
+                << tag { "detector", evt.station_id }
+                << tag { "site_id", evt.user + evt.station_id }
+                << influx::field<std::uint32_t> { "accuracy", evt.time_acc }
+                << influx::field<std::string> { "uuid", uuid.to_string() }
+                << influx::field<std::size_t> { "coinc_level", event.n() }
+                << influx::field<std::uint16_t> { "counter", evt.ublox_counter }
+                << influx::field<int_fast64_t> { "length", evt.duration() }
+                << influx::field<int_fast64_t> { "coinc_time", evt.start - event.data.start }
+                << influx::field<int_fast64_t> { "cluster_coinc_time", cluster_coinc_time }
+                << influx::field<std::uint8_t> { "time_ref", evt.gnss_time_grid }
+                << influx::field<std::uint8_t> { "valid_fix", evt.fix }
+                << influx::field<bool> { "conflicting", event.conflicting }
+                << influx::field<double> { "plausibility", plausibility })
+                 .commit(evt.start)) {
+            return;
+        }
+    }
+}
+} // namespace legacy
+
+constexpr std::size_t s_multiplicity { 3 }; //!< The number of detectors in each coincidence of the sink benchmark
+
+/**
+ * @brief coincidences Groups random event data into coincidences, as they are passed to the sinks
+ * @param n The number of coincidences
+ */
+auto coincidences(std::size_t n) -> std::vector<muonpi::event_t>
+{
+    auto events { generate(n * s_multiplicity) };
+
+    std::vector<muonpi::event_t> result {};
+    result.reserve(n);
+    for (std::size_t i { 0 }; i < n; i++) {
+        const auto first { events[i * s_multiplicity].start };
+        muonpi::event_t coincidence { events[i * s_multiplicity] };
+        for (std::size_t j { 0 }; j < s_multiplicity; j++) {
+            auto& data { events[i * s_multiplicity + j] };
+            const auto length { data.duration() };
+            data.start = first + static_cast<std::int64_t>(j) * 150;
+            data.end = data.start + length;
+            data.user = "benchmark" + std::to_string(j);
+            data.station_id = "detector";
+            data.hash = std::hash<std::string> {}(data.user + data.station_id);
+            data.location.geohash = "u0v90h";
+            coincidence.emplace(std::move(data));
+        }
+        coincidence.true_e = static_cast<std::uint8_t>(s_multiplicity);
+        result.emplace_back(std::move(coincidence));
+    }
+    return result;
+}
+
+/**
+ * @brief sinks Compares the former formatting of the event sinks to the current one, which uses text_buffer
+ * The mqtt link is not connected to a broker, so publishing returns right away and only the formatting is measured.
+ * The database link collects all records of a run in a single batch, and drops it when the benchmark is done.
+ * @param n The number of messages, each coincidence results in one message per detector
+ */
+void sinks(std::size_t n)
+{
+    const auto events { coincidences(std::max<std::size_t>(n / s_multiplicity, 1)) };
+    const std::size_t messages { events.size() * s_multiplicity };
+
+    muonpi::link::mqtt::configuration mqtt_config {};
+    mqtt_config.host = "localhost";
+    mqtt_config.port = s_unreachable_port;
+    muonpi::link::mqtt mqtt_link { mqtt_config, "benchmark", "muon::mqtt::bm" };
+    auto& publisher { mqtt_link.publish("muonpi/benchmark/l1data/") };
+
+    measure("mqtt sink, legacy", messages, [&] {
+        for (const auto& event : events) {
+            legacy::mqtt_event(publisher, event, true);
+        }
+        return messages;
+    });
+
+    muonpi::sink::mqtt<muonpi::event_t> mqtt_sink { publisher, true };
+    measure("mqtt sink, text_buffer", messages, [&] {
+        for (const auto& event : events) {
+            mqtt_sink.get(event);
+        }
+        return messages;
+    });
+
+    legacy::influx legacy_link {};
+    measure("database sink, legacy", messages, [&] {
+        for (const auto& event : events) {
+            legacy::database_event(legacy_link, event);
+        }
+        return legacy_link.lines();
+    });
+
+    muonpi::link::influx_batch::configuration influx_config {};
+    influx_config.host = "http://localhost:" + std::to_string(s_unreachable_port);
+    influx_config.database = "benchmark";
+    influx_config.batch_size = messages + 1;
+    influx_config.batch_interval = std::chrono::hours { 1 };
+    muonpi::link::influx_batch influx_link { influx_config };
+    muonpi::sink::database<muonpi::event_t> database_sink { influx_link };
+    measure("database sink, text_buffer", messages, [&] {
+        for (const auto& event : events) {
+            database_sink.get(event);
+        }
+        return messages;
+    });
+    influx_link.stop();
+    influx_link.wait();
+}
+} // namespace
+
+auto main(int argc, const char* argv[]) -> int
+{
+    namespace po = boost::program_options;
+
+    po::options_description desc("General options");
+    desc.add_options()("help,h", "produce help message")("messages,n", po::value<std::size_t>()->default_value(1'000'000), "Number of messages per benchmark");
+
+    po::variables_map options {};
+    po::store(po::parse_command_line(argc, argv, desc), options);
+    if (options.count("help")) {
+        std::cout << "benchmark\n"
+                  << "Measures the per message cost of the detector-network-processor.\n\n"
+                  << desc << '\n';
+        return 0;
+    }
+    po::notify(options);
+
+    const auto n { options.at("messages").as<std::size_t>() };
+    if (n == 0) {
+        std::cerr << "The number of messages has to be greater than 0\n";
+        return 1;
+    }
+
+    decoding(n);
+    sinks(n);
+
+    return 0;
+}
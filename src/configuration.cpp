@@ -40,11 +40,30 @@ auto setup(int argc, const char* argv[]) -> std::optional<config>
     file.add_option("sink_mqtt_password", po::value<std::string>(), "MQTT password to use for the sink");
     file.add_option("sink_mqtt_host", po::value<std::string>(), "MQTT hostname for the sink");
     file.add_option("sink_mqtt_port", po::value<int>(), "MQTT port for the sink");
+    file.add_option("sink_mqtt_compact", po::value<bool>()->default_value(false), "Publish cluster logs and detector summaries as one message each.");
 
     file.add_option("influx_user", po::value<std::string>(), "InfluxDb Username");
     file.add_option("influx_password", po::value<std::string>(), "InfluxDb Password");
     file.add_option("influx_database", po::value<std::string>(), "InfluxDb Database");
     file.add_option("influx_host", po::value<std::string>(), "InfluxDB Hostname");
+    file.add_option("influx_batch_size", po::value<int>()->default_value(Config::Default::influx.batch_size), "Number of records after which they are written to the InfluxDB in one request.");
+    file.add_option("influx_batch_interval", po::value<int>()->default_value(Config::Default::influx.batch_interval.count()), "Maximum time records are collected before they are written to the InfluxDB. In milliseconds.");
+    file.add_option("influx_gzip", po::value<bool>()->default_value(Config::Default::influx.gzip), "Compress the requests to the InfluxDB.");
+    file.add_option("influx_queue_size", po::value<int>()->default_value(Config::Default::influx.queue_size), "Maximum number of unwritten InfluxDB records kept in memory while the database is unavailable.");
+    file.add_option("influx_spill_file", po::value<std::string>()->default_value(Config::Default::files.spill), "File to store unwritten InfluxDB records in once the queue is full. Empty drops them instead.");
+
+    file.add_option("archive_directory", po::value<std::string>()->default_value(""), "Directory to archive events, detector summaries and triggers in. Empty disables the archive.");
+    file.add_option("archive_file_size", po::value<int>()->default_value(Config::Default::archive.file_size), "Size after which a new archive file is started. In MiB.");
+    file.add_option("archive_file_age", po::value<int>()->default_value(Config::Default::archive.file_age.count()), "Time after which a new archive file is started. In minutes.");
+    file.add_option("archive_buffer_size", po::value<int>()->default_value(Config::Default::archive.buffer_size), "Amount of data collected before it is written to the archive. In KiB.");
+    file.add_option("archive_sync_interval", po::value<int>()->default_value(Config::Default::archive.sync_interval.count()), "Maximum time before archived data is written and synced to disk. In milliseconds.");
+
+    file.add_option("columnar_directory", po::value<std::string>()->default_value(""), "Directory to write the columnar coincidence archive to. Empty disables it.");
+    file.add_option("columnar_block_size", po::value<int>()->default_value(Config::Default::columnar.block_size), "Number of coincidences per block of the columnar archive.");
+    file.add_option("columnar_flush_interval", po::value<int>()->default_value(Config::Default::columnar.flush_interval.count()), "Maximum time before coincidences are written to the columnar archive. In seconds.");
+
+    file.add_option("shm_name", po::value<std::string>()->default_value(""), "Name of the shared memory rings coincidences and detector summaries are published to. Empty disables them.");
+    file.add_option("shm_slots", po::value<int>()->default_value(Config::Default::shared_memory.slots), "Number of records each shared memory ring holds.");
 
     file.add_option("ldap_bind_dn", po::value<std::string>(), "LDAP Bind DN");
     file.add_option("ldap_password", po::value<std::string>(), "LDAP Bind Password");
@@ -53,9 +72,19 @@ auto setup(int argc, const char* argv[]) -> std::optional<config>
     file.add_option("store_histogram", po::value<bool>()->default_value(false), "Track and store histograms.");
     file.add_option("histogram", po::value<std::string>()->default_value("data"), "Storage location of the histograms");
     file.add_option("histogram_sample_time", po::value<int>()->default_value(std::chrono::duration_cast<std::chrono::hours>(Config::Default::interval.histogram_sample_time).count()), "histogram sample time to use. In hours.");
+    file.add_option("histogram_text_format", po::value<bool>()->default_value(Config::Default::histogram.text_format), "Store histograms as text files per station pair instead of one binary file per sample.");
+    file.add_option("histogram_compress", po::value<bool>()->default_value(Config::Default::histogram.compress), "Compress the histograms in the binary histogram files.");
+    file.add_option("histogram_capacity", po::value<int>()->default_value(Config::Default::histogram.capacity), "Maximum number of station pairs with histograms.");
+    file.add_option("source_buffer_size", po::value<int>()->default_value(Config::Default::source.buffer_size), "Maximum number of partially received items each source keeps at the same time.");
+    file.add_option("source_buffer_timeout", po::value<int>()->default_value(Config::Default::source.buffer_timeout.count()), "Time after which partially received items get discarded. In seconds.");
+    file.add_option("source_identity_cache", po::value<int>()->default_value(Config::Default::source.identity_cache), "Number of topics whose parsed identity each source caches per decoding thread. Should cover the number of active detectors.");
+    file.add_option("decode_workers", po::value<int>()->default_value(Config::Default::source.decode_workers), "Number of threads decoding incoming messages. 0 decodes on the mqtt thread.");
     file.add_option("geohash_length", po::value<int>()->default_value(Config::Default::meta.max_geohash_length), "Geohash length to use");
     file.add_option("clusterlog_interval", po::value<int>()->default_value(std::chrono::duration_cast<std::chrono::minutes>(Config::Default::interval.clusterlog).count()), "Interval in which to send the cluster log. In minutes.");
     file.add_option("detectorsummary_interval", po::value<int>()->default_value(std::chrono::duration_cast<std::chrono::minutes>(Config::Default::interval.detectorsummary).count()), "Interval in which to send the detector summary. In minutes.");
+    file.add_option("state_file", po::value<std::string>()->default_value(Config::Default::files.state), "File to save the detector states to, so they are restored after a restart. Empty disables saving.");
+    file.add_option("state_interval", po::value<int>()->default_value(std::chrono::duration_cast<std::chrono::minutes>(Config::Default::interval.state).count()), "Interval in which to save the detector states. In minutes.");
+    file.add_option("checkpoint_file", po::value<std::string>()->default_value(Config::Default::files.checkpoint), "File to save unfinished coincidences to on shutdown, so they are completed after a restart. Empty disables saving.");
 
     if (cfg.is_set("help")) {
         log::info() << "\n"
@@ -67,6 +96,16 @@ auto setup(int argc, const char* argv[]) -> std::optional<config>
 
     file.commit(config_file);
 
+    // these are used as divisor, as the size of a buffer or as a flush interval, zero or a negative value would break the component
+    for (const auto* option : { "shm_slots", "columnar_block_size", "source_identity_cache",
+             "archive_buffer_size", "archive_sync_interval", "archive_file_size", "archive_file_age",
+             "influx_batch_size", "influx_queue_size", "influx_batch_interval" }) {
+        if (cfg.get<int>(option) <= 0) {
+            log::error("config") << "'" << option << "' has to be greater than 0";
+            return {};
+        }
+    }
+
     return cfg;
 }
 
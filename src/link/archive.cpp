@@ -0,0 +1,232 @@
+#include "link/archive.h"
+
+#include <muonpi/log.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace muonpi::link {
+
+archive::archive(configuration config)
+    : thread_runner { "muon::archive" }
+    , m_config { std::move(config) }
+{
+    std::error_code error {};
+    std::filesystem::create_directories(m_config.directory, error);
+    if (error) {
+        log::error("archive") << "Could not create directory '" << m_config.directory << "': " << error.message();
+    }
+    m_collecting.data.reserve(m_config.buffer_size);
+    m_writing.data.reserve(m_config.buffer_size);
+    start();
+}
+
+void archive::append(std::int_fast64_t timestamp, std::string_view record)
+{
+    bool full { false };
+    {
+        std::scoped_lock<std::mutex> lock { m_mutex };
+        if (m_collecting.records == 0) {
+            m_collecting.first = timestamp;
+            m_collecting.last = timestamp;
+        } else {
+            m_collecting.first = std::min(m_collecting.first, timestamp);
+            m_collecting.last = std::max(m_collecting.last, timestamp);
+        }
+        m_collecting.data.append(record.data(), record.size());
+        m_collecting.records++;
+        full = m_collecting.data.size() >= m_config.buffer_size;
+    }
+    if (full) {
+        m_condition.notify_all();
+    }
+}
+
+auto archive::index_file() const -> std::string
+{
+    return (std::filesystem::path { m_config.directory } / (m_config.prefix + ".index")).string();
+}
+
+auto archive::find(const std::string& index_file, std::int_fast64_t from, std::int_fast64_t to) -> std::vector<index_entry>
+{
+    std::vector<index_entry> listed {};
+    std::ifstream in { index_file };
+    index_entry entry {};
+    while (in >> entry.file >> entry.first >> entry.last >> entry.records) {
+        // a later entry of the same file replaces the one written when it was opened
+        auto existing { std::find_if(listed.rbegin(), listed.rend(), [&](const index_entry& e) { return e.file == entry.file; }) };
+        if (existing != listed.rend()) {
+            *existing = entry;
+        } else {
+            listed.emplace_back(entry);
+        }
+    }
+
+    std::vector<index_entry> entries {};
+    const std::filesystem::path directory { std::filesystem::path { index_file }.parent_path() };
+    for (auto& e : listed) {
+        if ((e.last < from) || (e.first > to)) {
+            continue;
+        }
+        e.file = (directory / e.file).string();
+        entries.emplace_back(std::move(e));
+    }
+    return entries;
+}
+
+auto archive::step() -> int
+{
+    {
+        std::unique_lock<std::mutex> lock { m_mutex };
+        m_condition.wait_for(lock, m_config.sync_interval, [this] { return m_quit || (m_collecting.data.size() >= m_config.buffer_size); });
+        // both buffers keep their capacity, so after the first few writes no memory is allocated
+        std::swap(m_collecting, m_writing);
+    }
+    write(false);
+    return 0;
+}
+
+auto archive::post_run() -> int
+{
+    {
+        std::scoped_lock<std::mutex> lock { m_mutex };
+        std::swap(m_collecting, m_writing);
+    }
+    write(true);
+    close();
+    return 0;
+}
+
+void archive::write(bool force_sync)
+{
+    if (m_writing.records > 0) {
+        if ((m_fd >= 0) && ((m_file_size >= m_config.max_file_size) || ((std::chrono::system_clock::now() - m_file_opened) >= m_config.max_file_age))) {
+            close();
+        }
+        if ((m_fd < 0) && !open()) {
+            if (!m_failed) {
+                log::error("archive") << "Could not open a file in '" << m_config.directory << "', dropping records until it succeeds";
+            }
+            m_failed = true;
+        } else {
+            m_failed = false;
+            const char* data { m_writing.data.data() };
+            std::size_t remaining { m_writing.data.size() };
+            while (remaining > 0) {
+                const ssize_t written { ::write(m_fd, data, remaining) };
+                if (written < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    log::warning("archive") << "Could not write to '" << m_current.file << "': " << std::strerror(errno);
+                    break;
+                }
+                data += written;
+                remaining -= static_cast<std::size_t>(written);
+            }
+            m_file_size += m_writing.data.size() - remaining;
+
+            const bool first_write { m_current.records == 0 };
+            if (first_write) {
+                m_current.first = m_writing.first;
+                m_current.last = m_writing.last;
+            } else {
+                m_current.first = std::min(m_current.first, m_writing.first);
+                m_current.last = std::max(m_current.last, m_writing.last);
+            }
+            m_current.records += m_writing.records;
+            m_unsynced = true;
+            if (first_write) {
+                add_to_index(std::numeric_limits<std::int_fast64_t>::max());
+            }
+        }
+        m_writing.data.clear();
+        m_writing.records = 0;
+    }
+
+    if (force_sync || ((std::chrono::steady_clock::now() - m_last_sync) >= m_config.sync_interval)) {
+        sync();
+    }
+}
+
+auto archive::open() -> bool
+{
+    const std::time_t now { std::chrono::system_clock::to_time_t(std::chrono::system_clock::now()) };
+    std::tm utc {};
+    gmtime_r(&now, &utc);
+    char time[32] {};
+    std::strftime(time, sizeof(time), "%Y%m%d-%H%M%S", &utc);
+
+    const std::string base { m_config.prefix + "-" + time };
+    std::string name { base + ".txt" };
+    for (std::size_t n { 1 };; n++) {
+        m_fd = ::open((std::filesystem::path { m_config.directory } / name).c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+        if (m_fd >= 0) {
+            break;
+        }
+        if (errno != EEXIST) {
+            return false;
+        }
+        // a file was already started within the same second
+        name = base + "-" + std::to_string(n) + ".txt";
+    }
+
+    m_current = index_entry {};
+    m_current.file = (std::filesystem::path { m_config.directory } / name).string();
+    m_file_size = 0;
+    m_file_opened = std::chrono::system_clock::now();
+    return true;
+}
+
+void archive::close()
+{
+    if (m_fd < 0) {
+        return;
+    }
+    sync();
+    ::close(m_fd);
+    m_fd = -1;
+
+    if (m_current.records == 0) {
+        std::error_code error {};
+        std::filesystem::remove(m_current.file, error);
+        return;
+    }
+
+    add_to_index(m_current.last);
+}
+
+void archive::add_to_index(std::int_fast64_t last)
+{
+    std::ofstream index { index_file(), std::ios::app };
+    index
+        << std::filesystem::path { m_current.file }.filename().string()
+        << ' ' << m_current.first
+        << ' ' << last
+        << ' ' << m_current.records << '\n';
+    if (!index) {
+        log::warning("archive") << "Could not add '" << m_current.file << "' to the index";
+    }
+}
+
+void archive::sync()
+{
+    m_last_sync = std::chrono::steady_clock::now();
+    if (!m_unsynced || (m_fd < 0)) {
+        return;
+    }
+    if (::fdatasync(m_fd) != 0) {
+        log::warning("archive") << "Could not sync '" << m_current.file << "': " << std::strerror(errno);
+    }
+    m_unsynced = false;
+}
+
+} // namespace muonpi::link
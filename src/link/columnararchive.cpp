@@ -0,0 +1,121 @@
+#include "link/columnararchive.h"
+
+#include "messages/columnar.h"
+
+#include <muonpi/log.h>
+
+#include <filesystem>
+#include <fstream>
+#include <map>
+
+namespace muonpi::link {
+
+columnar_archive::columnar_archive(configuration config)
+    : thread_runner { "muon::columnar" }
+    , m_config { std::move(config) }
+{
+    std::error_code error {};
+    std::filesystem::create_directories(m_config.directory, error);
+    if (error) {
+        log::error("columnar") << "Could not create directory '" << m_config.directory << "': " << error.message();
+    }
+    m_collecting.reserve(m_config.block_size);
+    m_writing.reserve(m_config.block_size);
+    start();
+}
+
+void columnar_archive::add(event_t event)
+{
+    bool full { false };
+    {
+        std::scoped_lock<std::mutex> lock { m_mutex };
+        m_collecting.emplace_back(std::move(event));
+        full = m_collecting.size() >= m_config.block_size;
+    }
+    if (full) {
+        m_condition.notify_all();
+    }
+}
+
+auto columnar_archive::step() -> int
+{
+    {
+        std::unique_lock<std::mutex> lock { m_mutex };
+        m_condition.wait_for(lock, m_config.flush_interval, [this] { return m_quit || (m_collecting.size() >= m_config.block_size); });
+        std::swap(m_collecting, m_writing);
+    }
+    write();
+    return 0;
+}
+
+auto columnar_archive::post_run() -> int
+{
+    {
+        std::scoped_lock<std::mutex> lock { m_mutex };
+        std::swap(m_collecting, m_writing);
+    }
+    write();
+    return 0;
+}
+
+void columnar_archive::write()
+{
+    if (m_writing.empty()) {
+        return;
+    }
+
+    // coincidences arrive roughly ordered, so a batch usually belongs to a single partition
+    std::map<std::int64_t, std::vector<event_t>> partitions {};
+    for (auto& event : m_writing) {
+        partitions[columnar::partition(event.data.start)].emplace_back(std::move(event));
+    }
+    m_writing.clear();
+
+    for (const auto& [start, events] : partitions) {
+        const std::filesystem::path path { std::filesystem::path { m_config.directory } / columnar::file_name(start) };
+        repair(start, path);
+        std::error_code error {};
+        const bool exists { std::filesystem::exists(path, error) };
+        const std::uintmax_t previous_size { exists ? std::filesystem::file_size(path, error) : 0 };
+        const bool size_known { !error };
+
+        std::ofstream out { path, std::ios::binary | std::ios::app };
+        if (((previous_size == 0) && !columnar::write_file_header(out)) || !columnar::write_block(out, events)) {
+            log::warning("columnar") << "Could not write " << events.size() << " coincidences to '" << path.string() << "'";
+            out.close();
+            // a partially written block would be followed by the next blocks and hide them from readers
+            if (size_known) {
+                std::filesystem::resize_file(path, previous_size, error);
+            }
+            if (!size_known || error) {
+                m_repaired.erase(start);
+            }
+        }
+    }
+}
+
+void columnar_archive::repair(std::int64_t partition_start, const std::filesystem::path& path)
+{
+    if (!m_repaired.emplace(partition_start).second) {
+        return;
+    }
+    // partitions which are a day older than the current one are hardly ever written again, checking them again would only cost a scan
+    m_repaired.erase(m_repaired.begin(), m_repaired.lower_bound(*m_repaired.rbegin() - s_repaired_age));
+
+    std::error_code error {};
+    const auto size { std::filesystem::file_size(path, error) };
+    if (error || (size == 0)) {
+        return;
+    }
+    const auto complete { columnar::complete_size(path.string()) };
+    if (complete >= size) {
+        return;
+    }
+    log::warning("columnar") << "Removing " << (size - complete) << " bytes of an incomplete block from '" << path.string() << "'";
+    std::filesystem::resize_file(path, complete, error);
+    if (error) {
+        log::warning("columnar") << "Could not truncate '" << path.string() << "': " << error.message();
+    }
+}
+
+} // namespace muonpi::link
@@ -0,0 +1,495 @@
+#include "link/influxbatch.h"
+
+#include "utility/binarystream.h"
+
+#include <muonpi/log.h>
+
+#include <boost/asio/connect.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ssl.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/beast/ssl.hpp>
+#include <boost/version.hpp>
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace muonpi::link {
+
+namespace {
+    /**
+     * @brief url_encode Percent-encodes a value for use in the query part of an url
+     */
+    [[nodiscard]] auto url_encode(const std::string& value) -> std::string
+    {
+        constexpr static const char* hex { "0123456789ABCDEF" };
+        std::string result {};
+        for (const char c : value) {
+            const auto byte { static_cast<unsigned char>(c) };
+            if ((std::isalnum(byte) != 0) || (c == '-') || (c == '_') || (c == '.') || (c == '~')) {
+                result += c;
+            } else {
+                result += '%';
+                result += hex[byte >> 4U];
+                result += hex[byte & 0x0FU];
+            }
+        }
+        return result;
+    }
+
+    /**
+     * @brief base64_encode Encodes a value in base64, as used for the credentials of a basic authorization header
+     */
+    [[nodiscard]] auto base64_encode(const std::string& value) -> std::string
+    {
+        constexpr static const char* alphabet { "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/" };
+        std::string result {};
+        result.reserve((value.size() + 2) / 3 * 4);
+        for (std::size_t i { 0 }; i < value.size(); i += 3) {
+            const std::size_t remaining { std::min<std::size_t>(3, value.size() - i) };
+            std::uint32_t group { static_cast<std::uint32_t>(static_cast<unsigned char>(value[i])) << 16U };
+            if (remaining > 1) {
+                group |= static_cast<std::uint32_t>(static_cast<unsigned char>(value[i + 1])) << 8U;
+            }
+            if (remaining > 2) {
+                group |= static_cast<std::uint32_t>(static_cast<unsigned char>(value[i + 2]));
+            }
+            result += alphabet[(group >> 18U) & 0x3FU];
+            result += alphabet[(group >> 12U) & 0x3FU];
+            result += (remaining > 1) ? alphabet[(group >> 6U) & 0x3FU] : '=';
+            result += (remaining > 2) ? alphabet[group & 0x3FU] : '=';
+        }
+        return result;
+    }
+
+    /**
+     * @brief gzip Compresses data into the gzip format
+     * @param data The data to compress
+     * @param compressed The string to write the compressed data to
+     * @return true on success
+     */
+    [[nodiscard]] auto gzip(const std::string& data, std::string& compressed) -> bool
+    {
+        constexpr static int window_bits { 15 + 16 }; // 16 selects the gzip header instead of zlib
+        constexpr static int memory_level { 8 };
+
+        z_stream stream {};
+        if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, window_bits, memory_level, Z_DEFAULT_STRATEGY) != Z_OK) {
+            return false;
+        }
+        compressed.resize(deflateBound(&stream, static_cast<uLong>(data.size())));
+
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+        stream.avail_in = static_cast<uInt>(data.size());
+        stream.next_out = reinterpret_cast<Bytef*>(compressed.data());
+        stream.avail_out = static_cast<uInt>(compressed.size());
+
+        const int result { deflate(&stream, Z_FINISH) };
+        compressed.resize(stream.total_out);
+        deflateEnd(&stream);
+        return result == Z_STREAM_END;
+    }
+
+    template <typename Stream>
+    [[nodiscard]] auto exchange(Stream& stream, boost::beast::http::request<boost::beast::http::string_body>& request) -> boost::beast::http::response<boost::beast::http::string_body>
+    {
+        boost::beast::http::write(stream, request);
+        boost::beast::flat_buffer buffer {};
+        boost::beast::http::response<boost::beast::http::string_body> response {};
+        boost::beast::http::read(stream, buffer, response);
+        return response;
+    }
+} // namespace
+
+influx_batch::entry::entry(std::string_view measurement, influx_batch& link, text_buffer& buffer)
+    : m_link { &link }
+    , m_buffer { &buffer }
+{
+    m_buffer->clear();
+    escape(*m_buffer, measurement, ", ");
+}
+
+auto influx_batch::entry::operator<<(const tag& t) -> entry&
+{
+    // empty tag values are not allowed in the line protocol
+    if (t.value.empty() || m_has_fields) {
+        return *this;
+    }
+    *m_buffer << ',';
+    escape(*m_buffer, t.name, ", =");
+    *m_buffer << '=';
+    escape(*m_buffer, t.value, ", =");
+    return *this;
+}
+
+auto influx_batch::entry::commit(std::int_fast64_t timestamp) -> bool
+{
+    if (!m_has_fields) {
+        return false;
+    }
+    *m_buffer << ' ' << timestamp << '\n';
+    m_link->append(m_buffer->view());
+    return true;
+}
+
+influx_batch::influx_batch(configuration config)
+    : thread_runner { "muon::influx" }
+    , m_config { std::move(config) }
+    , m_destination { parse_destination(m_config) }
+{
+    recover_spill();
+    start();
+}
+
+auto influx_batch::measurement(std::string_view measurement, text_buffer& buffer) -> entry
+{
+    return entry { measurement, *this, buffer };
+}
+
+void influx_batch::escape(text_buffer& out, std::string_view value, const char* characters)
+{
+    for (const char c : value) {
+        if (std::strchr(characters, c) != nullptr) {
+            out << '\\';
+        }
+        out << c;
+    }
+}
+
+void influx_batch::append(std::string_view line)
+{
+    bool full { false };
+    {
+        std::scoped_lock<std::mutex> lock { m_mutex };
+        m_buffer += line;
+        m_lines++;
+        full = m_lines >= m_config.batch_size;
+    }
+    if (full) {
+        m_condition.notify_all();
+    }
+}
+
+auto influx_batch::statistics() const -> const queue_statistics&
+{
+    return m_statistics;
+}
+
+auto influx_batch::step() -> int
+{
+    {
+        std::unique_lock<std::mutex> lock { m_mutex };
+        m_condition.wait_for(lock, m_config.batch_interval, [this] { return m_quit || (m_lines >= m_config.batch_size); });
+    }
+    collect();
+    send_pending();
+    return 0;
+}
+
+auto influx_batch::post_run() -> int
+{
+    collect();
+    if (send_pending()) {
+        return 0;
+    }
+    if (m_queue.empty() && (m_spill_offset == 0)) {
+        return 0;
+    }
+    // whatever could not be sent is kept in the spill file for the next run.
+    // The queued batches are older than the spilled ones, so they are written in front of them.
+    std::size_t records { 0 };
+    for (const auto& queued : m_queue) {
+        records += queued.n;
+    }
+    if (store_pending()) {
+        m_statistics.spilled += records;
+    } else {
+        log::warning("influx") << "Dropping " << records << " queued records, they could not be spilled";
+        m_statistics.dropped += records;
+    }
+    m_statistics.queued -= records;
+    m_queue.clear();
+    return 0;
+}
+
+void influx_batch::collect()
+{
+    batch records {};
+    {
+        std::scoped_lock<std::mutex> lock { m_mutex };
+        if (m_lines == 0) {
+            return;
+        }
+        std::swap(records.lines, m_buffer);
+        std::swap(records.n, m_lines);
+    }
+
+    if (!m_spilling && ((m_statistics.queued + records.n) <= m_config.queue_size)) {
+        m_statistics.queued += records.n;
+        m_queue.emplace_back(std::move(records));
+        return;
+    }
+    if (!spill(records)) {
+        log::warning("influx") << "Dropping " << records.n << " records, the queue is full and they could not be spilled";
+        m_statistics.dropped += records.n;
+    }
+}
+
+auto influx_batch::send_pending() -> bool
+{
+    while (!m_queue.empty()) {
+        const auto result { send(m_queue.front()) };
+        if (result == delivery::failed) {
+            return false;
+        }
+        if (result == delivery::rejected) {
+            m_statistics.dropped += m_queue.front().n;
+        }
+        m_statistics.queued -= m_queue.front().n;
+        m_queue.pop_front();
+    }
+
+    while (m_spilling) {
+        batch records {};
+        if (!read_spilled(records)) {
+            std::error_code error {};
+            std::filesystem::remove(m_config.spill_file, error);
+            m_spilling = false;
+            m_spill_offset = 0;
+            m_statistics.spilled = 0;
+            log::info("influx") << "Replayed all spilled records";
+            break;
+        }
+        const auto result { send(records) };
+        if (result == delivery::failed) {
+            return false;
+        }
+        if (result == delivery::rejected) {
+            m_statistics.dropped += records.n;
+        }
+        m_spill_offset += static_cast<std::streamoff>(sizeof(std::uint32_t) * 2 + records.lines.size());
+        m_statistics.spilled -= std::min<std::size_t>(m_statistics.spilled, records.n);
+    }
+    return true;
+}
+
+auto influx_batch::send(const batch& records) -> delivery
+{
+    std::string body {};
+    if (m_config.gzip && !gzip(records.lines, body)) {
+        log::warning("influx") << "Could not compress batch, sending it uncompressed";
+        m_config.gzip = false;
+    }
+    const auto result { post(m_config.gzip ? body : records.lines) };
+    if (result == delivery::failed) {
+        log::warning("influx") << "error writing batch of " << records.n << " records to DB";
+    } else if (result == delivery::rejected) {
+        // keeping the batch would block every later batch, since the database would reject it again on each attempt
+        log::error("influx") << "Dropping batch of " << records.n << " records rejected by the DB, first record: " << records.lines.substr(0, records.lines.find('\n'));
+    }
+    return result;
+}
+
+auto influx_batch::spill(const batch& records) -> bool
+{
+    if (m_config.spill_file.empty()) {
+        return false;
+    }
+    std::ofstream file { m_config.spill_file, std::ios::binary | std::ios::app };
+    binary::writer out { file };
+    out.put<std::uint32_t>(static_cast<std::uint32_t>(records.n));
+    out.put(records.lines);
+    file.flush();
+    if (!out.good()) {
+        return false;
+    }
+    if (!m_spilling) {
+        log::warning("influx") << "Database queue is full, spilling records to '" << m_config.spill_file << "'";
+    }
+    m_spilling = true;
+    m_statistics.spilled += records.n;
+    return true;
+}
+
+auto influx_batch::read_spilled(batch& records) -> bool
+{
+    std::ifstream file { m_config.spill_file, std::ios::binary };
+    if (!file.is_open() || !file.seekg(m_spill_offset)) {
+        return false;
+    }
+    binary::reader in { file, s_max_batch_length };
+    records.n = in.get<std::uint32_t>();
+    records.lines = in.get<std::string>();
+    return in.good();
+}
+
+auto influx_batch::store_pending() -> bool
+{
+    if (m_config.spill_file.empty()) {
+        return false;
+    }
+    const std::string temporary { m_config.spill_file + ".tmp" };
+    {
+        std::ofstream file { temporary, std::ios::binary | std::ios::trunc };
+        binary::writer out { file };
+        for (const auto& records : m_queue) {
+            out.put<std::uint32_t>(static_cast<std::uint32_t>(records.n));
+            out.put(records.lines);
+        }
+        // batches which were already replayed are not copied, so they are not sent twice
+        if (m_spilling) {
+            std::ifstream spilled { m_config.spill_file, std::ios::binary };
+            if (spilled.is_open() && spilled.seekg(m_spill_offset) && (spilled.peek() != std::ifstream::traits_type::eof())) {
+                file << spilled.rdbuf();
+            }
+        }
+        file.flush();
+        if (!out.good()) {
+            std::error_code error {};
+            std::filesystem::remove(temporary, error);
+            return false;
+        }
+    }
+    std::error_code error {};
+    std::filesystem::rename(temporary, m_config.spill_file, error);
+    return !error;
+}
+
+void influx_batch::recover_spill()
+{
+    if (m_config.spill_file.empty()) {
+        return;
+    }
+    std::ifstream file { m_config.spill_file, std::ios::binary };
+    if (!file.is_open()) {
+        return;
+    }
+    // only count the records, their content is read when they are replayed
+    binary::reader in { file, s_max_batch_length };
+    std::size_t records { 0 };
+    while (true) {
+        const auto n { in.get<std::uint32_t>() };
+        const auto length { in.get<std::uint32_t>() };
+        if (!in.good() || !file.seekg(length, std::ios::cur)) {
+            break;
+        }
+        records += n;
+    }
+    if (records == 0) {
+        return;
+    }
+    m_spilling = true;
+    m_statistics.spilled = records;
+    log::info("influx") << "Found " << records << " spilled records from an earlier run, replaying them";
+}
+
+auto influx_batch::post(const std::string& body) -> delivery
+{
+    namespace beast = boost::beast;
+    namespace http = beast::http;
+    namespace net = boost::asio;
+    using tcp = net::ip::tcp;
+
+    http::request<http::string_body> request { http::verb::post, m_destination.target, 11 };
+    request.set(http::field::host, m_destination.host);
+    request.set(http::field::user_agent, "detector-network-processor");
+    request.set(http::field::content_type, "text/plain; charset=utf-8");
+    if (!m_destination.authorization.empty()) {
+        request.set(http::field::authorization, m_destination.authorization);
+    }
+    if (m_config.gzip) {
+        request.set(http::field::content_encoding, "gzip");
+    }
+    request.body() = body;
+    request.prepare_payload();
+
+    try {
+        net::io_context context {};
+        tcp::resolver resolver { context };
+        const auto endpoints { resolver.resolve(m_destination.host, m_destination.port) };
+
+        http::response<http::string_body> response {};
+        if (m_destination.ssl) {
+            net::ssl::context ssl_context { net::ssl::context::tls_client };
+            ssl_context.set_default_verify_paths();
+            ssl_context.set_verify_mode(net::ssl::verify_peer);
+
+            beast::ssl_stream<beast::tcp_stream> stream { context, ssl_context };
+#if BOOST_VERSION >= 107300
+            stream.set_verify_callback(net::ssl::host_name_verification { m_destination.host });
+#else
+            stream.set_verify_callback(net::ssl::rfc2818_verification { m_destination.host });
+#endif
+            if (SSL_set_tlsext_host_name(stream.native_handle(), m_destination.host.c_str()) == 0) {
+                log::warning("influx") << "Could not set SNI hostname";
+                return delivery::failed;
+            }
+            beast::get_lowest_layer(stream).expires_after(s_request_timeout);
+            beast::get_lowest_layer(stream).connect(endpoints);
+            stream.handshake(net::ssl::stream_base::client);
+
+            response = exchange(stream, request);
+
+            beast::error_code error {};
+            stream.shutdown(error);
+        } else {
+            beast::tcp_stream stream { context };
+            stream.expires_after(s_request_timeout);
+            stream.connect(endpoints);
+
+            response = exchange(stream, request);
+
+            beast::error_code error {};
+            stream.socket().shutdown(tcp::socket::shutdown_both, error);
+        }
+
+        if (http::to_status_class(response.result()) != http::status_class::successful) {
+            log::warning("influx") << "DB rejected batch: " << response.result_int() << " " << response.body();
+            // server errors, rate limiting and wrong credentials concern every batch, anything else in 4xx concerns the content of this one
+            const bool temporary { (http::to_status_class(response.result()) != http::status_class::client_error)
+                || (response.result() == http::status::too_many_requests)
+                || (response.result() == http::status::unauthorized)
+                || (response.result() == http::status::forbidden) };
+            return temporary ? delivery::failed : delivery::rejected;
+        }
+    } catch (const std::exception& e) {
+        log::warning("influx") << "Could not send batch: " << e.what();
+        return delivery::failed;
+    }
+    return delivery::accepted;
+}
+
+auto influx_batch::parse_destination(const configuration& config) -> destination
+{
+    destination result {};
+    std::string host { config.host };
+    if (host.rfind("http://", 0) == 0) {
+        result.ssl = false;
+        host = host.substr(7);
+    } else if (host.rfind("https://", 0) == 0) {
+        host = host.substr(8);
+    }
+    if (const auto slash { host.find('/') }; slash != std::string::npos) {
+        host = host.substr(0, slash);
+    }
+    result.port = result.ssl ? "443" : "80";
+    if (const auto colon { host.find(':') }; colon != std::string::npos) {
+        result.port = host.substr(colon + 1);
+        host = host.substr(0, colon);
+    }
+    result.host = host;
+    result.target = "/write?db=" + url_encode(config.database) + "&precision=ns";
+    // the credentials are sent in a header, so they do not show up in the access logs of proxies and the DB
+    if (!config.login.username.empty()) {
+        result.authorization = "Basic " + base64_encode(config.login.username + ":" + config.login.password);
+    }
+    return result;
+}
+
+} // namespace muonpi::link
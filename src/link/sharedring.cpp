@@ -0,0 +1,91 @@
+#include "link/sharedring.h"
+
+#include <muonpi/log.h>
+
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace muonpi::link {
+
+shared_ring::shared_ring(configuration config, shm::record_type type, std::size_t record_size)
+    : m_config { std::move(config) }
+    , m_record_size { record_size }
+    , m_stride { shm::slot_stride(record_size) }
+    , m_size { shm::ring_size(record_size, m_config.slots) }
+{
+    // a ring left over by a previous run is replaced, readers of it see it as closed once it is unlinked
+    shm_unlink(m_config.name.c_str());
+    const int fd { shm_open(m_config.name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644) };
+    if (fd < 0) {
+        log::error("shm") << "Could not create shared memory '" << m_config.name << "': " << std::strerror(errno);
+        return;
+    }
+    if (ftruncate(fd, static_cast<off_t>(m_size)) != 0) {
+        log::error("shm") << "Could not resize shared memory '" << m_config.name << "': " << std::strerror(errno);
+        close(fd);
+        shm_unlink(m_config.name.c_str());
+        return;
+    }
+    void* memory { mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) };
+    close(fd);
+    if (memory == MAP_FAILED) {
+        log::error("shm") << "Could not map shared memory '" << m_config.name << "': " << std::strerror(errno);
+        shm_unlink(m_config.name.c_str());
+        return;
+    }
+
+    auto* bytes { static_cast<std::byte*>(memory) };
+    m_slots = bytes + sizeof(shm::ring_header);
+    for (std::size_t i { 0 }; i < m_config.slots; i++) {
+        new (m_slots + i * m_stride) shm::slot_header {};
+    }
+
+    m_header = new (memory) shm::ring_header {};
+    m_header->type = type;
+    m_header->record_size = static_cast<std::uint32_t>(m_record_size);
+    m_header->slot_count = m_config.slots;
+    m_header->version = shm::s_version;
+    // readers check the magic number last, so they never see a partially initialised header
+    std::atomic_thread_fence(std::memory_order_release);
+    m_header->magic = shm::s_magic;
+}
+
+shared_ring::~shared_ring()
+{
+    if (m_header == nullptr) {
+        return;
+    }
+    m_header->closed.store(1, std::memory_order_release);
+    munmap(m_header, m_size);
+    shm_unlink(m_config.name.c_str());
+}
+
+void shared_ring::publish(const void* record)
+{
+    if (m_header == nullptr) {
+        return;
+    }
+    auto* slot { m_slots + (m_sequence % m_config.slots) * m_stride };
+    auto* header { reinterpret_cast<shm::slot_header*>(slot) };
+
+    header->sequence.store(2 * m_sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(slot + sizeof(shm::slot_header), record, m_record_size);
+    header->sequence.store(2 * m_sequence + 2, std::memory_order_release);
+
+    m_sequence++;
+    m_header->head.store(m_sequence, std::memory_order_release);
+}
+
+auto shared_ring::good() const -> bool
+{
+    return m_header != nullptr;
+}
+
+} // namespace muonpi::link
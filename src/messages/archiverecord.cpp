@@ -0,0 +1,35 @@
+#include "messages/archiverecord.h"
+
+#include <muonpi/utility.h>
+
+namespace muonpi::archive_record {
+
+void put(text_buffer& out, const event_t& event)
+{
+    const std::string uuid { guid { event.data.hash, static_cast<std::uint64_t>(event.data.start) }.to_string() };
+    for (const auto& evt : event.events) {
+        out
+            << uuid
+            << ' ' << event.n()
+            << ' ' << event.conflicting
+            << ' ' << event.true_e
+            << ' ' << evt.user
+            << ' ' << evt.station_id
+            << ' ';
+        out.append_hex(evt.hash);
+        out
+            << ' ' << evt.start
+            << ' ' << evt.end
+            << ' ' << evt.time_acc
+            << ' ' << evt.ublox_counter
+            << ' ' << evt.fix
+            << ' ' << evt.utc
+            << ' ' << evt.gnss_time_grid
+            << ' ';
+        out.append(evt.location.lat, text_buffer::s_shortest) << ' ';
+        out.append(evt.location.lon, text_buffer::s_shortest) << ' ';
+        out.append(evt.location.h, text_buffer::s_shortest) << '\n';
+    }
+}
+
+} // namespace muonpi::archive_record
@@ -0,0 +1,58 @@
+#include "messages/binaryevent.h"
+
+#include <type_traits>
+
+namespace muonpi::binary_event {
+
+template <typename T>
+[[nodiscard]] auto read(std::string_view payload, std::size_t offset) -> T
+{
+    using U = std::make_unsigned_t<T>;
+    U value { 0 };
+    for (std::size_t i { 0 }; i < sizeof(T); i++) {
+        value |= static_cast<U>(static_cast<U>(static_cast<std::uint8_t>(payload[offset + i])) << (8U * i));
+    }
+    return static_cast<T>(value);
+}
+
+template <typename T>
+void write(std::string& payload, std::size_t offset, T value)
+{
+    using U = std::make_unsigned_t<T>;
+    const U raw { static_cast<U>(value) };
+    for (std::size_t i { 0 }; i < sizeof(T); i++) {
+        payload[offset + i] = static_cast<char>(static_cast<std::uint8_t>(raw >> (8U * i)));
+    }
+}
+
+auto decode(std::string_view payload, event_t::data_t& data) -> bool
+{
+    if ((payload.size() != size) || (read<std::uint8_t>(payload, 0) != version)) {
+        return false;
+    }
+    data.fix = read<std::uint8_t>(payload, 1);
+    data.utc = read<std::uint8_t>(payload, 2);
+    data.gnss_time_grid = read<std::uint8_t>(payload, 3);
+    data.ublox_counter = read<std::uint16_t>(payload, 4);
+    data.time_acc = read<std::uint32_t>(payload, 8);
+    data.start = read<std::int64_t>(payload, 16);
+    data.end = read<std::int64_t>(payload, 24);
+
+    return data.start <= data.end;
+}
+
+auto encode(const event_t::data_t& data) -> std::string
+{
+    std::string payload(size, '\0');
+    write<std::uint8_t>(payload, 0, version);
+    write<std::uint8_t>(payload, 1, data.fix);
+    write<std::uint8_t>(payload, 2, data.utc);
+    write<std::uint8_t>(payload, 3, data.gnss_time_grid);
+    write<std::uint16_t>(payload, 4, data.ublox_counter);
+    write<std::uint32_t>(payload, 8, data.time_acc);
+    write<std::int64_t>(payload, 16, data.start);
+    write<std::int64_t>(payload, 24, data.end);
+    return payload;
+}
+
+} // namespace muonpi::binary_event
@@ -0,0 +1,522 @@
+#include "messages/columnar.h"
+
+#include "utility/binarystream.h"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <unordered_map>
+
+namespace muonpi::columnar {
+
+namespace {
+    constexpr std::uint32_t s_file_magic { 0x4143504D }; // "MPCA"
+    constexpr std::uint32_t s_block_magic { 0x4243504D }; // "MPCB"
+    constexpr std::uint32_t s_version { 1 };
+    constexpr std::uint32_t s_max_block_size { 1U << 28U };
+    constexpr std::int64_t s_partition_length { 3600LL * 1'000'000'000LL };
+    constexpr std::int64_t s_ns_per_second { 1'000'000'000LL };
+
+    /**
+     * @brief The encoder class
+     * Appends values to one column.
+     */
+    class encoder {
+    public:
+        void varint(std::uint64_t value)
+        {
+            while (value >= 0x80U) {
+                m_data += static_cast<char>((value & 0x7FU) | 0x80U);
+                value >>= 7U;
+            }
+            m_data += static_cast<char>(value);
+        }
+
+        void zigzag(std::int64_t value)
+        {
+            varint((static_cast<std::uint64_t>(value) << 1U) ^ static_cast<std::uint64_t>(value >> 63));
+        }
+
+        void byte(std::uint8_t value)
+        {
+            m_data += static_cast<char>(value);
+        }
+
+        void fixed(std::uint64_t value)
+        {
+            for (std::size_t i { 0 }; i < sizeof(value); i++) {
+                m_data += static_cast<char>(static_cast<std::uint8_t>(value >> (8U * i)));
+            }
+        }
+
+        void real(double value)
+        {
+            std::uint64_t raw {};
+            std::memcpy(&raw, &value, sizeof(raw));
+            fixed(raw);
+        }
+
+        void string(const std::string& value)
+        {
+            varint(value.size());
+            m_data += value;
+        }
+
+        [[nodiscard]] auto data() const -> const std::string&
+        {
+            return m_data;
+        }
+
+    private:
+        std::string m_data {};
+    };
+
+    /**
+     * @brief The decoder class
+     * Reads the values written by the encoder. Once a read fails, all following reads return 0.
+     */
+    class decoder {
+    public:
+        explicit decoder(const std::string& data)
+            : m_data { data }
+        {
+        }
+
+        [[nodiscard]] auto varint() -> std::uint64_t
+        {
+            std::uint64_t value { 0 };
+            for (unsigned shift { 0 }; shift < 64U; shift += 7U) {
+                if (m_position >= m_data.size()) {
+                    break;
+                }
+                const auto current { static_cast<std::uint8_t>(m_data[m_position++]) };
+                value |= static_cast<std::uint64_t>(current & 0x7FU) << shift;
+                if ((current & 0x80U) == 0) {
+                    return value;
+                }
+            }
+            m_good = false;
+            return 0;
+        }
+
+        [[nodiscard]] auto zigzag() -> std::int64_t
+        {
+            const std::uint64_t value { varint() };
+            return static_cast<std::int64_t>(value >> 1U) ^ -static_cast<std::int64_t>(value & 1U);
+        }
+
+        [[nodiscard]] auto byte() -> std::uint8_t
+        {
+            if (m_position >= m_data.size()) {
+                m_good = false;
+                return 0;
+            }
+            return static_cast<std::uint8_t>(m_data[m_position++]);
+        }
+
+        [[nodiscard]] auto fixed() -> std::uint64_t
+        {
+            std::uint64_t value { 0 };
+            for (std::size_t i { 0 }; i < sizeof(value); i++) {
+                value |= static_cast<std::uint64_t>(byte()) << (8U * i);
+            }
+            return value;
+        }
+
+        [[nodiscard]] auto real() -> double
+        {
+            const std::uint64_t raw { fixed() };
+            double value {};
+            std::memcpy(&value, &raw, sizeof(value));
+            return value;
+        }
+
+        [[nodiscard]] auto string() -> std::string
+        {
+            const std::uint64_t length { varint() };
+            if (!m_good || (length > (m_data.size() - m_position))) {
+                m_good = false;
+                return {};
+            }
+            std::string value { m_data.substr(m_position, length) };
+            m_position += length;
+            return value;
+        }
+
+        [[nodiscard]] auto good() const -> bool
+        {
+            return m_good;
+        }
+
+    private:
+        const std::string& m_data;
+        std::size_t m_position { 0 };
+        bool m_good { true };
+    };
+
+    struct detector {
+        std::uint64_t hash {};
+        std::string user {};
+        std::string station_id {};
+        double lat {};
+        double lon {};
+        double h {};
+    };
+} // namespace
+
+auto partition(std::int64_t time) -> std::int64_t
+{
+    return time - (((time % s_partition_length) + s_partition_length) % s_partition_length);
+}
+
+auto file_name(std::int64_t partition_start) -> std::string
+{
+    const std::time_t time { static_cast<std::time_t>(partition_start / s_ns_per_second) };
+    std::tm utc {};
+    gmtime_r(&time, &utc);
+    char name[64] {};
+    const std::size_t length { std::strftime(name, sizeof(name), "coincidences-%Y%m%d-%H.col", &utc) };
+    return std::string(name, length);
+}
+
+auto files(const std::string& directory, std::int64_t from, std::int64_t to) -> std::vector<std::string>
+{
+    std::vector<std::pair<std::int64_t, std::string>> found {};
+    std::error_code error {};
+    for (const auto& entry : std::filesystem::directory_iterator { directory, error }) {
+        if (!entry.is_regular_file()) {
+            continue;
+        }
+        std::tm utc {};
+        const std::string name { entry.path().filename().string() };
+        if (std::sscanf(name.c_str(), "coincidences-%4d%2d%2d-%2d.col", &utc.tm_year, &utc.tm_mon, &utc.tm_mday, &utc.tm_hour) != 4) {
+            continue;
+        }
+        utc.tm_year -= 1900;
+        utc.tm_mon -= 1;
+        const std::int64_t start { static_cast<std::int64_t>(timegm(&utc)) * s_ns_per_second };
+        if ((start > to) || ((start + s_partition_length) <= from)) {
+            continue;
+        }
+        found.emplace_back(start, entry.path().string());
+    }
+    std::sort(found.begin(), found.end());
+
+    std::vector<std::string> result {};
+    result.reserve(found.size());
+    for (auto& [start, path] : found) {
+        result.emplace_back(std::move(path));
+    }
+    return result;
+}
+
+auto write_file_header(std::ostream& out) -> bool
+{
+    binary::writer writer { out };
+    writer.put<std::uint32_t>(s_file_magic);
+    writer.put<std::uint32_t>(s_version);
+    return writer.good();
+}
+
+auto write_block(std::ostream& out, const std::vector<event_t>& events) -> bool
+{
+    block_header header {};
+
+    encoder dictionary {};
+    std::unordered_map<std::uint64_t, std::uint32_t> detectors {};
+
+    // coincidence columns
+    encoder start {};
+    encoder duration {};
+    encoder hash {};
+    encoder n {};
+    encoder conflicting {};
+    encoder true_e {};
+
+    // event columns
+    encoder detector_index {};
+    encoder offset {};
+    encoder length {};
+    encoder time_acc {};
+    encoder ublox_counter {};
+    encoder fix {};
+    encoder utc {};
+    encoder gnss_time_grid {};
+
+    std::int64_t previous_start { 0 };
+    for (const auto& event : events) {
+        if (event.n() < 2) {
+            continue;
+        }
+        if (header.coincidences == 0) {
+            header.first = event.data.start;
+            header.last = event.data.start;
+        } else {
+            header.first = std::min<std::int64_t>(header.first, event.data.start);
+            header.last = std::max<std::int64_t>(header.last, event.data.start);
+        }
+        start.zigzag(event.data.start - previous_start);
+        previous_start = event.data.start;
+        duration.zigzag(event.data.end - event.data.start);
+        hash.fixed(event.data.hash);
+        n.varint(event.events.size());
+        conflicting.byte(event.conflicting ? 1U : 0U);
+        true_e.byte(event.true_e);
+        header.coincidences++;
+
+        for (const auto& evt : event.events) {
+            auto [it, inserted] { detectors.emplace(evt.hash, static_cast<std::uint32_t>(detectors.size())) };
+            if (inserted) {
+                dictionary.fixed(evt.hash);
+                dictionary.string(evt.user);
+                dictionary.string(evt.station_id);
+                dictionary.real(evt.location.lat);
+                dictionary.real(evt.location.lon);
+                dictionary.real(evt.location.h);
+            }
+            detector_index.varint(it->second);
+            offset.zigzag(evt.start - event.data.start);
+            length.zigzag(evt.duration());
+            time_acc.varint(evt.time_acc);
+            ublox_counter.varint(evt.ublox_counter);
+            fix.byte(evt.fix);
+            utc.byte(evt.utc);
+            gnss_time_grid.byte(evt.gnss_time_grid);
+            header.rows++;
+        }
+    }
+    if (header.coincidences == 0) {
+        return true;
+    }
+
+    encoder count {};
+    count.varint(detectors.size());
+
+    std::string raw {};
+    for (const auto* column : { &count, &dictionary, &start, &duration, &hash, &n, &conflicting, &true_e, &detector_index, &offset, &length, &time_acc, &ublox_counter, &fix, &utc, &gnss_time_grid }) {
+        raw += column->data();
+    }
+    if (raw.size() > s_max_block_size) {
+        return false;
+    }
+
+    uLongf compressed_size { compressBound(static_cast<uLong>(raw.size())) };
+    std::string compressed(compressed_size, '\0');
+    if (compress2(reinterpret_cast<Bytef*>(compressed.data()), &compressed_size, reinterpret_cast<const Bytef*>(raw.data()), static_cast<uLong>(raw.size()), Z_DEFAULT_COMPRESSION) != Z_OK) {
+        return false;
+    }
+    header.raw_size = static_cast<std::uint32_t>(raw.size());
+    header.compressed_size = static_cast<std::uint32_t>(compressed_size);
+
+    binary::writer writer { out };
+    writer.put<std::uint32_t>(s_block_magic);
+    writer.put<std::uint32_t>(header.coincidences);
+    writer.put<std::uint32_t>(header.rows);
+    writer.put<std::int64_t>(header.first);
+    writer.put<std::int64_t>(header.last);
+    writer.put<std::uint32_t>(header.raw_size);
+    writer.put<std::uint32_t>(header.compressed_size);
+    out.write(compressed.data(), static_cast<std::streamsize>(compressed_size));
+    return writer.good();
+}
+
+auto complete_size(const std::string& path) -> std::uint64_t
+{
+    std::error_code error {};
+    const auto size { std::filesystem::file_size(path, error) };
+    file_reader reader { path };
+    if (error || !reader.good()) {
+        return 0;
+    }
+    std::uint64_t complete { reader.position() };
+    block_header header {};
+    // seeking past the end of the file succeeds, so a truncated payload is only detected by the size
+    while (reader.next(header) && reader.skip(header)) {
+        const auto end { reader.position() };
+        if (end > size) {
+            break;
+        }
+        complete = end;
+    }
+    return complete;
+}
+
+file_reader::file_reader(const std::string& path)
+    : m_in { path, std::ios::binary }
+{
+    binary::reader reader { m_in };
+    const auto magic { reader.get<std::uint32_t>() };
+    const auto version { reader.get<std::uint32_t>() };
+    m_good = reader.good() && (magic == s_file_magic) && (version == s_version);
+}
+
+auto file_reader::good() const -> bool
+{
+    return m_good;
+}
+
+auto file_reader::next(block_header& header) -> bool
+{
+    if (!m_good) {
+        return false;
+    }
+    binary::reader reader { m_in };
+    const auto magic { reader.get<std::uint32_t>() };
+    header.coincidences = reader.get<std::uint32_t>();
+    header.rows = reader.get<std::uint32_t>();
+    header.first = reader.get<std::int64_t>();
+    header.last = reader.get<std::int64_t>();
+    header.raw_size = reader.get<std::uint32_t>();
+    header.compressed_size = reader.get<std::uint32_t>();
+    // an incomplete block at the end of the file, e.g. after a crash, ends the file
+    m_good = reader.good() && (magic == s_block_magic) && (header.raw_size <= s_max_block_size) && (header.compressed_size <= s_max_block_size);
+    return m_good;
+}
+
+auto file_reader::position() -> std::uint64_t
+{
+    const auto position { m_in.tellg() };
+    return (position < 0) ? 0 : static_cast<std::uint64_t>(position);
+}
+
+auto file_reader::skip(const block_header& header) -> bool
+{
+    m_good = m_good && static_cast<bool>(m_in.seekg(header.compressed_size, std::ios::cur));
+    return m_good;
+}
+
+auto file_reader::read(const block_header& header, std::vector<event_t>& events) -> bool
+{
+    if (!m_good) {
+        return false;
+    }
+    m_compressed.resize(header.compressed_size);
+    if (!m_in.read(m_compressed.data(), static_cast<std::streamsize>(header.compressed_size))) {
+        m_good = false;
+        return false;
+    }
+    // every coincidence and every row takes at least one byte of the raw block, larger counts can only come from a damaged header
+    if ((header.coincidences > header.raw_size) || (header.rows > header.raw_size)) {
+        return false;
+    }
+    m_raw.resize(header.raw_size);
+    uLongf raw_size { header.raw_size };
+    if ((uncompress(reinterpret_cast<Bytef*>(m_raw.data()), &raw_size, reinterpret_cast<const Bytef*>(m_compressed.data()), header.compressed_size) != Z_OK) || (raw_size != header.raw_size)) {
+        return false;
+    }
+
+    decoder in { m_raw };
+
+    const std::uint64_t n_detectors { in.varint() };
+    if (n_detectors > header.rows) {
+        return false;
+    }
+    std::vector<detector> detectors(n_detectors);
+    for (auto& det : detectors) {
+        det.hash = in.fixed();
+        det.user = in.string();
+        det.station_id = in.string();
+        det.lat = in.real();
+        det.lon = in.real();
+        det.h = in.real();
+    }
+
+    const std::size_t first_event { events.size() };
+    events.resize(first_event + header.coincidences);
+    const auto coincidences { events.begin() + static_cast<std::ptrdiff_t>(first_event) };
+
+    std::int64_t previous_start { 0 };
+    std::for_each(coincidences, events.end(), [&](event_t& event) { previous_start += in.zigzag(); event.data.start = previous_start; });
+    std::for_each(coincidences, events.end(), [&](event_t& event) { event.data.end = event.data.start + in.zigzag(); });
+    std::for_each(coincidences, events.end(), [&](event_t& event) { event.data.hash = in.fixed(); });
+    bool damaged { false };
+    std::size_t rows { 0 };
+    std::for_each(coincidences, events.end(), [&](event_t& event) {
+        const std::uint64_t n { in.varint() };
+        if ((n > header.rows) || ((rows + n) > header.rows)) {
+            damaged = true;
+            return;
+        }
+        event.events.resize(n);
+        rows += n;
+    });
+    if (!in.good() || damaged || (rows != header.rows)) {
+        events.resize(first_event);
+        return false;
+    }
+    std::for_each(coincidences, events.end(), [&](event_t& event) { event.conflicting = (in.byte() != 0); });
+    std::for_each(coincidences, events.end(), [&](event_t& event) { event.true_e = in.byte(); });
+
+    const auto for_each_row { [&](auto&& function) {
+        for (auto it { coincidences }; it != events.end(); ++it) {
+            for (auto& evt : it->events) {
+                function(*it, evt);
+            }
+        }
+    } };
+
+    for_each_row([&](const event_t&, event_t::data_t& evt) {
+        const std::uint64_t index { in.varint() };
+        if (index >= detectors.size()) {
+            damaged = true;
+            return;
+        }
+        const auto& det { detectors[index] };
+        evt.hash = det.hash;
+        evt.user = det.user;
+        evt.station_id = det.station_id;
+        evt.userinfo = userinfo_t { det.user, det.station_id };
+        evt.location.lat = det.lat;
+        evt.location.lon = det.lon;
+        evt.location.h = det.h;
+    });
+    for_each_row([&](const event_t& event, event_t::data_t& evt) { evt.start = event.data.start + in.zigzag(); });
+    for_each_row([&](const event_t&, event_t::data_t& evt) { evt.end = evt.start + in.zigzag(); });
+    for_each_row([&](const event_t&, event_t::data_t& evt) { evt.time_acc = static_cast<std::uint32_t>(in.varint()); });
+    for_each_row([&](const event_t&, event_t::data_t& evt) { evt.ublox_counter = static_cast<std::uint16_t>(in.varint()); });
+    for_each_row([&](const event_t&, event_t::data_t& evt) { evt.fix = in.byte(); });
+    for_each_row([&](const event_t&, event_t::data_t& evt) { evt.utc = in.byte(); });
+    for_each_row([&](const event_t&, event_t::data_t& evt) { evt.gnss_time_grid = in.byte(); });
+
+    if (!in.good() || damaged) {
+        events.resize(first_event);
+        return false;
+    }
+    return true;
+}
+
+auto scan(const std::string& directory, std::int64_t from, std::int64_t to, const std::function<void(const event_t&)>& callback) -> std::size_t
+{
+    std::size_t found { 0 };
+    std::vector<event_t> events {};
+    for (const auto& path : files(directory, from, to)) {
+        file_reader reader { path };
+        block_header header {};
+        while (reader.next(header)) {
+            if ((header.last < from) || (header.first > to)) {
+                if (!reader.skip(header)) {
+                    break;
+                }
+                continue;
+            }
+            events.clear();
+            if (!reader.read(header, events)) {
+                break;
+            }
+            for (const auto& event : events) {
+                if ((event.data.start < from) || (event.data.start > to)) {
+                    continue;
+                }
+                callback(event);
+                found++;
+            }
+        }
+    }
+    return found;
+}
+
+} // namespace muonpi::columnar
@@ -0,0 +1,216 @@
+#include "messages/histogramepoch.h"
+
+#include <zlib.h>
+
+#include <cstring>
+#include <filesystem>
+#include <numeric>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace muonpi::epoch {
+
+namespace {
+    constexpr std::uint64_t s_alignment { 8 };
+
+    [[nodiscard]] auto aligned(std::uint64_t position) -> std::uint64_t
+    {
+        return (position + s_alignment - 1) / s_alignment * s_alignment;
+    }
+
+    void pad(std::ofstream& out, std::uint64_t& position)
+    {
+        constexpr char zeros[s_alignment] {};
+        const std::uint64_t next { aligned(position) };
+        out.write(zeros, static_cast<std::streamsize>(next - position));
+        position = next;
+    }
+
+    [[nodiscard]] auto within(std::uint64_t offset, std::uint64_t size, std::uint64_t total) -> bool
+    {
+        return (offset <= total) && (size <= (total - offset));
+    }
+}
+
+auto file_name(const std::string& stem) -> std::string
+{
+    return stem + ".epoch";
+}
+
+writer::writer(std::string path, std::int64_t start, std::int64_t end, std::uint32_t bins, bool compress, const std::vector<station>& stations)
+    : m_path { std::move(path) }
+    , m_temporary { m_path + ".tmp" }
+    , m_out { m_temporary, std::ios::binary | std::ios::trunc }
+{
+    m_header.start = start;
+    m_header.end = end;
+    m_header.bins = bins;
+    m_header.flags = compress ? s_compressed : 0;
+    m_header.stations = static_cast<std::uint32_t>(stations.size());
+
+    // the header is written again with the final offsets once the file is complete
+    m_out.write(reinterpret_cast<const char*>(&m_header), sizeof(m_header));
+    std::uint64_t position { sizeof(m_header) };
+
+    m_header.names_offset = position;
+    std::vector<station_entry> entries {};
+    entries.reserve(stations.size());
+    for (const auto& s : stations) {
+        entries.emplace_back(station_entry { s.hash, s.lat, s.lon, s.h, static_cast<std::uint32_t>(position - m_header.names_offset), static_cast<std::uint32_t>(s.name.size()) });
+        m_out.write(s.name.data(), static_cast<std::streamsize>(s.name.size()));
+        position += s.name.size();
+    }
+    m_header.names_size = position - m_header.names_offset;
+    pad(m_out, position);
+
+    m_header.stations_offset = position;
+    m_out.write(reinterpret_cast<const char*>(entries.data()), static_cast<std::streamsize>(entries.size() * sizeof(station_entry)));
+    position += entries.size() * sizeof(station_entry);
+    pad(m_out, position);
+
+    m_header.data_offset = position;
+}
+
+void writer::add(pair_entry entry, const std::uint32_t* counts)
+{
+    entry.total = 0;
+    entry.offset = m_header.data_size;
+    entry.size = 0;
+    if (counts != nullptr) {
+        entry.total = std::accumulate(counts, counts + m_header.bins, std::uint64_t { 0 });
+
+        const char* blob { reinterpret_cast<const char*>(counts) };
+        uLongf size { static_cast<uLongf>(m_header.bins * sizeof(std::uint32_t)) };
+        if ((m_header.flags & s_compressed) != 0) {
+            m_compressed.resize(compressBound(size));
+            uLongf compressed_size { static_cast<uLongf>(m_compressed.size()) };
+            if (compress2(reinterpret_cast<Bytef*>(m_compressed.data()), &compressed_size, reinterpret_cast<const Bytef*>(blob), size, Z_DEFAULT_COMPRESSION) != Z_OK) {
+                m_out.setstate(std::ios::failbit);
+                return;
+            }
+            blob = m_compressed.data();
+            size = compressed_size;
+        }
+        m_out.write(blob, static_cast<std::streamsize>(size));
+        entry.size = size;
+
+        std::uint64_t position { m_header.data_offset + m_header.data_size + size };
+        pad(m_out, position);
+        m_header.data_size = position - m_header.data_offset;
+    }
+    m_pairs.emplace_back(entry);
+}
+
+auto writer::finish() -> bool
+{
+    m_header.pairs = static_cast<std::uint32_t>(m_pairs.size());
+    m_header.pairs_offset = m_header.data_offset + m_header.data_size;
+    m_out.write(reinterpret_cast<const char*>(m_pairs.data()), static_cast<std::streamsize>(m_pairs.size() * sizeof(pair_entry)));
+
+    m_out.seekp(0);
+    m_out.write(reinterpret_cast<const char*>(&m_header), sizeof(m_header));
+    m_out.close();
+    if (!m_out) {
+        return false;
+    }
+
+    std::error_code error {};
+    std::filesystem::rename(m_temporary, m_path, error);
+    return !error;
+}
+
+reader::reader(const std::string& path)
+{
+    const int fd { open(path.c_str(), O_RDONLY | O_CLOEXEC) };
+    if (fd < 0) {
+        return;
+    }
+    struct stat info { };
+    if ((fstat(fd, &info) != 0) || (static_cast<std::size_t>(info.st_size) < sizeof(file_header))) {
+        close(fd);
+        return;
+    }
+    m_size = static_cast<std::size_t>(info.st_size);
+    void* memory { mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0) };
+    close(fd);
+    if (memory == MAP_FAILED) {
+        m_size = 0;
+        return;
+    }
+    m_data = static_cast<const std::byte*>(memory);
+
+    const auto& h { header() };
+    m_good = (h.magic == s_magic)
+        && (h.version == s_version)
+        && within(h.names_offset, h.names_size, m_size)
+        && within(h.stations_offset, std::uint64_t { h.stations } * sizeof(station_entry), m_size)
+        && within(h.data_offset, h.data_size, m_size)
+        && within(h.pairs_offset, std::uint64_t { h.pairs } * sizeof(pair_entry), m_size)
+        && ((h.stations_offset % s_alignment) == 0)
+        && ((h.pairs_offset % s_alignment) == 0);
+}
+
+reader::~reader()
+{
+    if (m_data != nullptr) {
+        munmap(const_cast<std::byte*>(m_data), m_size);
+    }
+}
+
+auto reader::good() const -> bool
+{
+    return m_good;
+}
+
+auto reader::header() const -> const file_header&
+{
+    return *reinterpret_cast<const file_header*>(m_data);
+}
+
+auto reader::station(std::size_t index) const -> const station_entry&
+{
+    return reinterpret_cast<const station_entry*>(m_data + header().stations_offset)[index];
+}
+
+auto reader::name(std::size_t index) const -> std::string_view
+{
+    const auto& entry { station(index) };
+    if (!within(entry.name_offset, entry.name_length, header().names_size)) {
+        return {};
+    }
+    return { reinterpret_cast<const char*>(m_data + header().names_offset + entry.name_offset), entry.name_length };
+}
+
+auto reader::pair(std::size_t index) const -> const pair_entry&
+{
+    return reinterpret_cast<const pair_entry*>(m_data + header().pairs_offset)[index];
+}
+
+auto reader::counts(const pair_entry& entry, std::vector<std::uint32_t>& counts) const -> bool
+{
+    const auto& h { header() };
+    counts.assign(h.bins, 0);
+    if (entry.size == 0) {
+        return true;
+    }
+    if (!within(entry.offset, entry.size, h.data_size)) {
+        return false;
+    }
+    const std::byte* blob { m_data + h.data_offset + entry.offset };
+    const std::size_t raw_size { counts.size() * sizeof(std::uint32_t) };
+    if ((h.flags & s_compressed) == 0) {
+        if (entry.size != raw_size) {
+            return false;
+        }
+        std::memcpy(counts.data(), blob, raw_size);
+        return true;
+    }
+    uLongf size { static_cast<uLongf>(raw_size) };
+    return (uncompress(reinterpret_cast<Bytef*>(counts.data()), &size, reinterpret_cast<const Bytef*>(blob), static_cast<uLong>(entry.size)) == Z_OK) && (size == raw_size);
+}
+
+} // namespace muonpi::epoch
@@ -0,0 +1,102 @@
+#include "messages/serialisation.h"
+
+namespace muonpi::binary {
+
+constexpr std::uint32_t s_max_events { 1024 }; //< upper limit for the number of events in a coincidence, used to detect damaged data
+
+void put(writer& out, const userinfo_t& userinfo)
+{
+    out.put(userinfo.username);
+    out.put(userinfo.station_id);
+}
+
+void get(reader& in, userinfo_t& userinfo)
+{
+    userinfo.username = in.get<std::string>();
+    userinfo.station_id = in.get<std::string>();
+}
+
+void put(writer& out, const location_t& location)
+{
+    out.put<double>(location.lat);
+    out.put<double>(location.lon);
+    out.put<double>(location.h);
+    out.put<double>(location.v_acc);
+    out.put<double>(location.h_acc);
+    out.put<double>(location.dop);
+    out.put(location.geohash);
+    out.put<std::uint8_t>(location.max_geohash_length);
+}
+
+void get(reader& in, location_t& location)
+{
+    location.lat = in.get<double>();
+    location.lon = in.get<double>();
+    location.h = in.get<double>();
+    location.v_acc = in.get<double>();
+    location.h_acc = in.get<double>();
+    location.dop = in.get<double>();
+    location.geohash = in.get<std::string>();
+    location.max_geohash_length = in.get<std::uint8_t>();
+}
+
+void put(writer& out, const event_t::data_t& data)
+{
+    put(out, data.location);
+    put(out, data.userinfo);
+    out.put<std::uint64_t>(data.hash);
+    out.put(data.user);
+    out.put(data.station_id);
+    out.put<std::int64_t>(data.start);
+    out.put<std::int64_t>(data.end);
+    out.put<std::uint32_t>(data.time_acc);
+    out.put<std::uint16_t>(data.ublox_counter);
+    out.put<std::uint8_t>(data.fix);
+    out.put<std::uint8_t>(data.utc);
+    out.put<std::uint8_t>(data.gnss_time_grid);
+}
+
+void get(reader& in, event_t::data_t& data)
+{
+    get(in, data.location);
+    get(in, data.userinfo);
+    data.hash = in.get<std::uint64_t>();
+    data.user = in.get<std::string>();
+    data.station_id = in.get<std::string>();
+    data.start = in.get<std::int64_t>();
+    data.end = in.get<std::int64_t>();
+    data.time_acc = in.get<std::uint32_t>();
+    data.ublox_counter = in.get<std::uint16_t>();
+    data.fix = in.get<std::uint8_t>();
+    data.utc = in.get<std::uint8_t>();
+    data.gnss_time_grid = in.get<std::uint8_t>();
+}
+
+void put(writer& out, const event_t& event)
+{
+    put(out, event.data);
+    out.put<std::uint8_t>(event.conflicting ? 1 : 0);
+    out.put<std::uint8_t>(event.true_e);
+    out.put<std::uint32_t>(static_cast<std::uint32_t>(event.events.size()));
+    for (const auto& data : event.events) {
+        put(out, data);
+    }
+}
+
+void get(reader& in, event_t& event)
+{
+    get(in, event.data);
+    event.conflicting = in.get<std::uint8_t>() != 0;
+    event.true_e = in.get<std::uint8_t>();
+    const auto n { in.get<std::uint32_t>() };
+    if (!in.good() || (n > s_max_events)) {
+        in.fail();
+        return;
+    }
+    event.events.resize(n);
+    for (auto& data : event.events) {
+        get(in, data);
+    }
+}
+
+} // namespace muonpi::binary
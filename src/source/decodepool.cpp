@@ -0,0 +1,72 @@
+#include "source/decodepool.h"
+
+#include <algorithm>
+#include <string>
+
+namespace muonpi::source {
+
+constexpr static std::chrono::duration s_timeout { std::chrono::milliseconds { 100 } };
+
+decode_pool::worker::worker(const std::string& name)
+    : sink::threaded<task> { name, s_timeout }
+{
+}
+
+void decode_pool::worker::get(task t)
+{
+    threaded<task>::internal_get(std::move(t));
+}
+
+auto decode_pool::worker::process(task t) -> int
+{
+    t();
+    return 0;
+}
+
+decode_pool::decode_pool(std::size_t workers)
+{
+    for (std::size_t i { 0 }; i < std::max<std::size_t>(workers, 1); i++) {
+        m_workers.emplace_back(std::make_unique<worker>("muon::decode" + std::to_string(i)));
+    }
+}
+
+decode_pool::~decode_pool()
+{
+    for (auto& w : m_workers) {
+        w->stop();
+    }
+    for (auto& w : m_workers) {
+        static_cast<void>(w->wait());
+    }
+}
+
+void decode_pool::dispatch(std::size_t key, task t)
+{
+    m_workers[worker_for(key)]->get(std::move(t));
+}
+
+auto decode_pool::worker_for(std::size_t key) const -> std::size_t
+{
+    return key % m_workers.size();
+}
+
+auto decode_pool::size() const -> std::size_t
+{
+    return m_workers.size();
+}
+
+auto decode_pool::threads() -> std::vector<std::reference_wrapper<thread_runner>>
+{
+    std::vector<std::reference_wrapper<thread_runner>> threads {};
+    for (auto& w : m_workers) {
+        threads.emplace_back(*w);
+    }
+    return threads;
+}
+
+auto decode_pool::forward_mutex() -> std::mutex&
+{
+    return m_forward_mutex;
+}
+
+} // namespace muonpi::source
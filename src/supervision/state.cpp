@@ -23,22 +23,22 @@ void state::time_status(std::chrono::milliseconds timebase, std::chrono::millise
 
 void state::on_detector_status(std::size_t hash, detector_status::status status)
 {
-    m_detectors[hash] = status;
-    if (status == detector_status::deleted) {
-        if (m_detectors.find(hash) != m_detectors.end()) {
-            m_detectors.erase(hash);
+    std::scoped_lock<std::mutex> lock { m_detectors_mutex };
+    auto it { m_detectors.find(hash) };
+    if (it != m_detectors.end()) {
+        m_status_count[it->second]--;
+        if (status == detector_status::deleted) {
+            m_detectors.erase(it);
+            return;
         }
-    }
-
-    std::size_t reliable { 0 };
-    for (auto& [h, detector] : m_detectors) {
-        if (detector == detector_status::reliable) {
-            reliable++;
+        it->second = status;
+    } else {
+        if (status == detector_status::deleted) {
+            return;
         }
+        m_detectors.emplace(hash, status);
     }
-
-    m_current_data.total_detectors = m_detectors.size();
-    m_current_data.reliable_detectors = reliable;
+    m_status_count[status]++;
 }
 
 auto state::step() -> int
@@ -64,6 +64,26 @@ auto state::step() -> int
     m_current_data.system_cpu_load = m_system_cpu_load.mean();
     m_current_data.plausibility_level = m_plausibility_level.mean();
 
+    {
+        std::scoped_lock<std::mutex> lock { m_detectors_mutex };
+        m_current_data.total_detectors = m_detectors.size();
+        m_current_data.reliable_detectors = m_status_count[detector_status::reliable];
+    }
+
+    m_current_data.source_buffer = {};
+    for (const source::buffer_statistics& buffer : m_source_buffers) {
+        m_current_data.source_buffer.length += buffer.size;
+        m_current_data.source_buffer.expired += buffer.expired;
+        m_current_data.source_buffer.dropped += buffer.dropped;
+    }
+
+    m_current_data.database_queue = {};
+    for (const link::queue_statistics& queue : m_database_queues) {
+        m_current_data.database_queue.queued += queue.queued;
+        m_current_data.database_queue.spilled += queue.spilled;
+        m_current_data.database_queue.dropped += queue.dropped;
+    }
+
     if ((now - m_last) >= m_config.clusterlog_interval) {
         m_last = now;
 
@@ -93,12 +113,19 @@ auto state::step() -> int
 
 auto state::post_run() -> int
 {
-    for (auto& fwd : m_threads) {
-        fwd.runner.stop();
-    }
     int result { 0 };
-    for (auto& fwd : m_threads) {
-        result += fwd.runner.wait();
+    // the storing threads are stopped last, so they still receive everything the other threads deliver while they finish
+    for (const bool store : { false, true }) {
+        for (auto& fwd : m_threads) {
+            if (fwd.store == store) {
+                fwd.runner.stop();
+            }
+        }
+        for (auto& fwd : m_threads) {
+            if (fwd.store == store) {
+                result += fwd.runner.wait();
+            }
+        }
     }
     return m_failure ? -1 : result;
 }
@@ -135,8 +162,18 @@ void state::set_queue_size(std::size_t size)
     m_current_data.buffer_length = size;
 }
 
-void state::add_thread(thread_runner& thread)
+void state::add_thread(thread_runner& thread, bool store)
+{
+    m_threads.emplace_back(forward { thread, store });
+}
+
+void state::add_source_buffer(const source::buffer_statistics& statistics)
+{
+    m_source_buffers.emplace_back(statistics);
+}
+
+void state::add_database_queue(const link::queue_statistics& statistics)
 {
-    m_threads.emplace_back(forward { thread });
+    m_database_queues.emplace_back(statistics);
 }
 } // namespace muonpi::supervision
@@ -10,6 +10,10 @@
 
 #include "supervision/state.h"
 
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+
 namespace muonpi::supervision {
 
 constexpr static std::chrono::duration s_timeout { std::chrono::milliseconds { 100 } };
@@ -25,24 +29,91 @@ station::station(sink::base<detector_summary_t>& summary_sink, sink::base<trigge
 {
 }
 
-void station::get(event_t event)
+auto station::shard_for(std::size_t hash) -> shard&
+{
+    return m_shards[hash % s_shards];
+}
+
+auto station::shard_for(std::size_t hash) const -> const shard&
 {
-    auto det_iterator { m_detectors.find(event.data.hash) };
-    if (det_iterator == m_detectors.end()) {
-        return;
+    return m_shards[hash % s_shards];
+}
+
+auto station::shard::find(std::size_t hash) -> detector_station*
+{
+    const auto it { index.find(hash) };
+    if (it == index.end()) {
+        return nullptr;
     }
-    auto& det { (*det_iterator).second };
+    return &detectors[it->second];
+}
 
-    if (!det->process(event)) {
-        return;
+auto station::shard::find(std::size_t hash) const -> const detector_station*
+{
+    const auto it { index.find(hash) };
+    if (it == index.end()) {
+        return nullptr;
+    }
+    return &detectors[it->second];
+}
+
+void station::shard::erase(std::size_t position)
+{
+    update_factor(detectors[position].hash(), 1.0, false);
+    index.erase(detectors[position].hash());
+    if (position != (detectors.size() - 1)) {
+        detectors[position] = std::move(detectors.back());
+        index[detectors[position].hash()] = position;
     }
+    detectors.pop_back();
+}
 
-    event.data.location = det->location();
-    event.data.userinfo = det->user_info();
+void station::shard::update_factor(std::size_t hash, double factor, bool reliable)
+{
+    if (const auto it { contributions.find(hash) }; it != contributions.end()) {
+        if (reliable && (*(it->second) == factor)) {
+            return;
+        }
+        factors.erase(it->second);
+        contributions.erase(it);
+    }
+    if (reliable) {
+        contributions.emplace(hash, factors.insert(factor));
+    }
+}
 
-    if (det->is(detector_status::reliable)) {
-        source::base<event_t>::put(std::move(event));
+auto station::shard::largest_factor() const -> double
+{
+    if (factors.empty()) {
+        return 1.0;
     }
+    return *factors.rbegin();
+}
+
+void station::get(event_t event)
+{
+    {
+        shard& detectors { shard_for(event.data.hash) };
+        std::scoped_lock<std::mutex> lock { detectors.mutex };
+
+        detector_station* det { detectors.find(event.data.hash) };
+        if (det == nullptr) {
+            return;
+        }
+
+        if (!det->process(event)) {
+            return;
+        }
+
+        if (!det->is(detector_status::reliable)) {
+            return;
+        }
+
+        event.data.location = det->location();
+        event.data.userinfo = det->user_info();
+    }
+
+    source::base<event_t>::put(std::move(event));
 }
 
 void station::get(detector_info_t<location_t> detector_info)
@@ -52,13 +123,16 @@ void station::get(detector_info_t<location_t> detector_info)
 
 auto station::process(detector_info_t<location_t> log) -> int
 {
-    auto det { m_detectors.find(log.hash) };
-    if (det == m_detectors.end()) {
-        m_detectors.emplace(log.hash, std::make_unique<detector_station>(log, *this));
-        m_detectors.at(log.hash)->enable();
+    shard& detectors { shard_for(log.hash) };
+    std::scoped_lock<std::mutex> lock { detectors.mutex };
+
+    if (detector_station* det { detectors.find(log.hash) }; det != nullptr) {
+        det->process(log);
         return 0;
     }
-    (*det).second->process(log);
+    detectors.index.emplace(log.hash, detectors.detectors.size());
+    detectors.detectors.emplace_back(log, *this).enable();
+    detectors.schedule.emplace(std::chrono::system_clock::now(), log.hash);
     return 0;
 }
 
@@ -68,35 +142,59 @@ auto station::process() -> int
     {
         double largest { 1.0 };
         system_clock::time_point now { system_clock::now() };
-        for (auto& [hash, det] : m_detectors) {
+        for (auto& detectors : m_shards) {
+            std::scoped_lock<std::mutex> lock { detectors.mutex };
+            while (!detectors.schedule.empty() && (detectors.schedule.top().first <= now)) {
+                const std::size_t hash { detectors.schedule.top().second };
+                detectors.schedule.pop();
 
-            det->step(now);
+                const auto it { detectors.index.find(hash) };
+                if (it == detectors.index.end()) {
+                    continue;
+                }
+                detector_station& det { detectors.detectors[it->second] };
 
-            if (det->is(detector_status::reliable)) {
-                if (det->factor() > largest) {
-                    largest = det->factor();
+                const system_clock::time_point next { det.step(now) };
+
+                if (det.is(detector_status::deleted)) {
+                    detectors.erase(it->second);
+                    continue;
                 }
+                detectors.update_factor(hash, det.factor(), det.is(detector_status::reliable));
+                detectors.schedule.emplace(next, hash);
             }
+            largest = std::max(largest, detectors.largest_factor());
         }
-        source::base<timebase_t>::put(timebase_t { static_cast<std::int64_t>(largest) });
-    }
 
-    while (!m_delete_detectors.empty()) {
-        m_detectors.erase(m_delete_detectors.front());
-        m_delete_detectors.pop();
+        // the timebase gets refreshed regularly even without a change, so the measured event spread gets updated
+        const auto factor { static_cast<std::int64_t>(largest) };
+        const auto steady_now { steady_clock::now() };
+        if ((factor != m_timebase_factor) || ((steady_now - m_last_timebase) >= s_timebase_interval)) {
+            m_timebase_factor = factor;
+            m_last_timebase = steady_now;
+            source::base<timebase_t>::put(timebase_t { factor });
+        }
     }
 
     // +++ push detector log messages at regular interval
     steady_clock::time_point now { steady_clock::now() };
 
+    if (!m_config.state_file.empty() && ((now - m_last_state) >= m_config.state_interval)) {
+        m_last_state = now;
+        save_state();
+    }
+
     if ((now - m_last) >= m_config.detectorsummary_interval) {
         m_last = now;
 
-        for (auto& [hash, det] : m_detectors) {
-            auto log = det->current_log_data();
-            log.station_id = m_config.station_id;
+        for (auto& detectors : m_shards) {
+            std::scoped_lock<std::mutex> lock { detectors.mutex };
+            for (auto& det : detectors.detectors) {
+                auto log = det.current_log_data();
+                log.station_id = m_config.station_id;
 
-            source::base<detector_summary_t>::put(log);
+                source::base<detector_summary_t>::put(log);
+            }
         }
     }
     // --- push detector log messages at regular interval
@@ -104,35 +202,113 @@ auto station::process() -> int
     return 0;
 }
 
-void station::on_detector_status(std::size_t hash, detector_status::status status, detector_status::reason reason)
+void station::on_detector_status(detector_station& detector, detector_status::status status, detector_status::reason reason)
 {
     if (status > detector_status::deleted) {
-        source::base<detector_summary_t>::put(m_detectors.at(hash)->change_log_data());
+        source::base<detector_summary_t>::put(detector.change_log_data());
     }
-    m_supervisor.on_detector_status(hash, status);
+    shard_for(detector.hash()).update_factor(detector.hash(), detector.factor(), status == detector_status::reliable);
+    m_supervisor.on_detector_status(detector.hash(), status);
 
-    if (status == detector_status::deleted) {
-        m_delete_detectors.push(hash);
+    source::base<trigger::detector>::put(trigger::detector { detector.hash(), detector.user_info(), status, reason });
+}
+
+auto station::save_state() const -> bool
+{
+    if (m_config.state_file.empty()) {
+        return false;
+    }
+    const std::string temporary { m_config.state_file + ".tmp" };
+    {
+        std::ofstream file { temporary, std::ios::binary | std::ios::trunc };
+        binary::writer out { file };
+        out.put<std::uint32_t>(s_state_magic);
+        out.put<std::uint16_t>(s_state_version);
+        out.put<std::uint32_t>(static_cast<std::uint32_t>(s_shards));
+        for (const auto& detectors : m_shards) {
+            std::scoped_lock<std::mutex> lock { detectors.mutex };
+            out.put<std::uint32_t>(static_cast<std::uint32_t>(detectors.detectors.size()));
+            for (const auto& det : detectors.detectors) {
+                det.save(out);
+            }
+        }
+        if (!out.good()) {
+            log::warning("station") << "Could not write detector state to '" << temporary << "'";
+            return false;
+        }
     }
-    source::base<trigger::detector>::put(trigger::detector { hash, m_detectors.at(hash)->user_info(), status, reason });
+    std::error_code error {};
+    std::filesystem::rename(temporary, m_config.state_file, error);
+    if (error) {
+        log::warning("station") << "Could not replace detector state file '" << m_config.state_file << "': " << error.message();
+        return false;
+    }
+    return true;
+}
+
+auto station::load_state() -> std::size_t
+{
+    if (m_config.state_file.empty()) {
+        return 0;
+    }
+    std::ifstream file { m_config.state_file, std::ios::binary };
+    if (!file.is_open()) {
+        return 0;
+    }
+    binary::reader in { file };
+    if ((in.get<std::uint32_t>() != s_state_magic) || (in.get<std::uint16_t>() != s_state_version)) {
+        log::warning("station") << "Ignoring detector state file '" << m_config.state_file << "' with unknown format";
+        return 0;
+    }
+
+    const auto now { std::chrono::system_clock::now() };
+    std::size_t restored { 0 };
+    const auto blocks { in.get<std::uint32_t>() };
+    for (std::uint32_t block { 0 }; (block < blocks) && in.good(); block++) {
+        const auto count { in.get<std::uint32_t>() };
+        for (std::uint32_t i { 0 }; (i < count) && in.good(); i++) {
+            auto detector { detector_station::restore(in, *this) };
+            if (!detector.has_value()) {
+                log::warning("station") << "Detector state file '" << m_config.state_file << "' is damaged, stopped reading after " << restored << " detectors";
+                return restored;
+            }
+            const std::size_t hash { detector->hash() };
+            shard& detectors { shard_for(hash) };
+            std::scoped_lock<std::mutex> lock { detectors.mutex };
+            if (detectors.find(hash) != nullptr) {
+                continue;
+            }
+            detectors.index.emplace(hash, detectors.detectors.size());
+            detectors.detectors.emplace_back(std::move(*detector)).enable();
+            detectors.schedule.emplace(now, hash);
+            restored++;
+        }
+    }
+    log::info("station") << "Restored " << restored << " detectors from '" << m_config.state_file << "'";
+    return restored;
 }
 
 auto station::get_stations() const -> std::vector<std::pair<userinfo_t, location_t>>
 {
     std::vector<std::pair<userinfo_t, location_t>> stations {};
-    for (const auto& [hash, stat] : m_detectors) {
-        stations.emplace_back(std::make_pair(stat->user_info(), stat->location()));
+    for (const auto& detectors : m_shards) {
+        std::scoped_lock<std::mutex> lock { detectors.mutex };
+        for (const auto& det : detectors.detectors) {
+            stations.emplace_back(std::make_pair(det.user_info(), det.location()));
+        }
     }
     return stations;
 }
 
 auto station::get_station(std::size_t hash) const -> std::pair<userinfo_t, location_t>
 {
-    const auto it { m_detectors.find(hash) };
-    if (it == m_detectors.end()) {
+    const shard& detectors { shard_for(hash) };
+    std::scoped_lock<std::mutex> lock { detectors.mutex };
+    const detector_station* det { detectors.find(hash) };
+    if (det == nullptr) {
         return {};
     }
-    return std::make_pair(it->second->user_info(), it->second->location());
+    return std::make_pair(det->user_info(), det->location());
 }
 
 } // namespace muonpi::supervision
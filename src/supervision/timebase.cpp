@@ -26,21 +26,22 @@ void timebase::get(event_t event)
 
 void timebase::get(timebase_t tb)
 {
-    if ((std::chrono::system_clock::now() - m_sample_start) < s_sample_time) {
-        tb.base = m_current;
-        pipeline::base<timebase_t>::put(tb);
-        return;
-    }
+    if ((std::chrono::system_clock::now() - m_sample_start) >= s_sample_time) {
+        m_sample_start = std::chrono::system_clock::now();
 
-    m_sample_start = std::chrono::system_clock::now();
+        m_current = std::clamp(std::chrono::nanoseconds { m_end - m_start }, s_minimum, s_maximum);
 
-    m_current = std::clamp(std::chrono::nanoseconds { m_end - m_start }, s_minimum, s_maximum);
+        m_start = std::numeric_limits<std::int_fast64_t>::max();
+        m_end = 0;
+    }
 
     tb.base = m_current;
 
-    pipeline::base<timebase_t>::put(tb);
+    if ((tb.factor == m_last.factor) && (tb.base == m_last.base)) {
+        return;
+    }
+    m_last = tb;
 
-    m_start = std::numeric_limits<std::int_fast64_t>::max();
-    m_end = 0;
+    pipeline::base<timebase_t>::put(tb);
 }
 } // namespace muonpi::supervision
@@ -0,0 +1,423 @@
+#include "link/influxbatch.h"
+#include "utility/textbuffer.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <iterator>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+using muonpi::link::influx_batch;
+using namespace std::chrono_literals;
+
+auto lines(const std::string& body) -> std::size_t
+{
+    return static_cast<std::size_t>(std::count(body.begin(), body.end(), '\n'));
+}
+
+/**
+ * @brief The server class is a minimal HTTP server on localhost, which records the write requests it receives
+ */
+class server {
+public:
+    struct request {
+        int status {}; //!< The status the request was answered with
+        std::string target {};
+        std::string authorization {};
+        std::string encoding {};
+        std::string body {}; //!< The body, already decompressed if it was sent with gzip
+    };
+
+    server()
+    {
+        m_socket = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in address {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = 0;
+        socklen_t length { sizeof(address) };
+        if ((m_socket < 0)
+            || (::bind(m_socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+            || (::listen(m_socket, s_backlog) != 0)
+            || (::getsockname(m_socket, reinterpret_cast<sockaddr*>(&address), &length) != 0)) {
+            throw std::runtime_error { "Could not listen on localhost" };
+        }
+        m_port = ntohs(address.sin_port);
+        m_thread = std::thread { [this] { run(); } };
+    }
+
+    ~server()
+    {
+        m_quit = true;
+        ::shutdown(m_socket, SHUT_RDWR);
+        ::close(m_socket);
+        m_thread.join();
+    }
+
+    server(const server&) = delete;
+    server(server&&) = delete;
+    auto operator=(const server&) -> server& = delete;
+    auto operator=(server&&) -> server& = delete;
+
+    [[nodiscard]] auto url() const -> std::string
+    {
+        return "http://127.0.0.1:" + std::to_string(m_port);
+    }
+
+    /**
+     * @brief set_status Sets the status the following requests are answered with
+     */
+    void set_status(int status)
+    {
+        m_status = status;
+    }
+
+    /**
+     * @brief accepted The requests answered with a successful status
+     */
+    [[nodiscard]] auto accepted() -> std::vector<request>
+    {
+        std::scoped_lock<std::mutex> lock { m_mutex };
+        std::vector<request> result {};
+        std::copy_if(m_requests.begin(), m_requests.end(), std::back_inserter(result), [](const request& r) { return (r.status / 100) == 2; });
+        return result;
+    }
+
+    /**
+     * @brief records The number of records in the accepted requests
+     */
+    [[nodiscard]] auto records() -> std::size_t
+    {
+        std::size_t n { 0 };
+        for (const auto& r : accepted()) {
+            n += lines(r.body);
+        }
+        return n;
+    }
+
+    /**
+     * @brief wait_for Waits until a number of records has been accepted
+     * @return false if the timeout expired before
+     */
+    [[nodiscard]] auto wait_for(std::size_t n, std::chrono::milliseconds timeout) -> bool
+    {
+        const auto deadline { std::chrono::steady_clock::now() + timeout };
+        while (records() < n) {
+            if (std::chrono::steady_clock::now() > deadline) {
+                return false;
+            }
+            std::this_thread::sleep_for(10ms);
+        }
+        return true;
+    }
+
+    void clear()
+    {
+        std::scoped_lock<std::mutex> lock { m_mutex };
+        m_requests.clear();
+    }
+
+private:
+    void run()
+    {
+        while (!m_quit) {
+            const int connection { ::accept(m_socket, nullptr, nullptr) };
+            if (connection < 0) {
+                continue;
+            }
+            handle(connection);
+            ::close(connection);
+        }
+    }
+
+    void handle(int connection)
+    {
+        std::string data {};
+        char buffer[4096] {};
+        std::size_t header_end { std::string::npos };
+        while ((header_end = data.find("\r\n\r\n")) == std::string::npos) {
+            const auto n { ::recv(connection, buffer, sizeof(buffer), 0) };
+            if (n <= 0) {
+                return;
+            }
+            data.append(buffer, static_cast<std::size_t>(n));
+        }
+
+        request received {};
+        const std::string header { data.substr(0, header_end) };
+        received.target = header.substr(header.find(' ') + 1, header.find(" HTTP/") - header.find(' ') - 1);
+        received.authorization = field(header, "authorization");
+        received.encoding = field(header, "content-encoding");
+        const std::size_t content_length { std::stoul("0" + field(header, "content-length")) };
+
+        std::string body { data.substr(header_end + 4) };
+        while (body.size() < content_length) {
+            const auto n { ::recv(connection, buffer, sizeof(buffer), 0) };
+            if (n <= 0) {
+                return;
+            }
+            body.append(buffer, static_cast<std::size_t>(n));
+        }
+        received.body = (received.encoding == "gzip") ? gunzip(body) : body;
+        received.status = m_status;
+
+        const std::string response { "HTTP/1.1 " + std::to_string(received.status) + " Test\r\nContent-Length: 0\r\nConnection: close\r\n\r\n" };
+        ::send(connection, response.data(), response.size(), MSG_NOSIGNAL);
+
+        std::scoped_lock<std::mutex> lock { m_mutex };
+        m_requests.emplace_back(std::move(received));
+    }
+
+    [[nodiscard]] static auto field(const std::string& header, const std::string& name) -> std::string
+    {
+        std::string lower { header };
+        std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        const auto start { lower.find("\r\n" + name + ":") };
+        if (start == std::string::npos) {
+            return {};
+        }
+        auto value { start + name.size() + 3 };
+        while ((value < header.size()) && (header[value] == ' ')) {
+            value++;
+        }
+        return header.substr(value, header.find("\r\n", value) - value);
+    }
+
+    [[nodiscard]] static auto gunzip(const std::string& data) -> std::string
+    {
+        constexpr static int window_bits { 15 + 16 };
+        z_stream stream {};
+        if (inflateInit2(&stream, window_bits) != Z_OK) {
+            return {};
+        }
+        std::string result {};
+        char buffer[4096] {};
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+        stream.avail_in = static_cast<uInt>(data.size());
+        int status { Z_OK };
+        while (status == Z_OK) {
+            stream.next_out = reinterpret_cast<Bytef*>(buffer);
+            stream.avail_out = sizeof(buffer);
+            status = inflate(&stream, Z_NO_FLUSH);
+            result.append(buffer, sizeof(buffer) - stream.avail_out);
+        }
+        inflateEnd(&stream);
+        return (status == Z_STREAM_END) ? result : std::string {};
+    }
+
+    static constexpr int s_backlog { 16 };
+
+    int m_socket { -1 };
+    std::uint16_t m_port { 0 };
+    std::atomic<bool> m_quit { false };
+    std::atomic<int> m_status { 204 };
+    std::mutex m_mutex {};
+    std::vector<request> m_requests {};
+    std::thread m_thread {};
+};
+
+int failures { 0 };
+
+void check(bool condition, const std::string& description)
+{
+    if (!condition) {
+        std::cerr << "FAILED: " << description << '\n';
+        failures++;
+    }
+}
+
+/**
+ * @brief write Writes records with consecutive values
+ * @param first The value of the first record
+ * @param n The number of records
+ */
+void write(influx_batch& link, int first, int n)
+{
+    muonpi::text_buffer buffer {};
+    for (int i { first }; i < (first + n); i++) {
+        auto entry { link.measurement("test", buffer) };
+        entry << influx_batch::field<int> { "v", i };
+        if (!entry.commit(i)) {
+            check(false, "commit of record " + std::to_string(i));
+        }
+    }
+}
+
+/**
+ * @brief values The values of all records in the bodies of the requests, in the order they were received
+ */
+auto values(const std::vector<server::request>& requests) -> std::vector<int>
+{
+    std::vector<int> result {};
+    for (const auto& r : requests) {
+        for (std::size_t position { r.body.find("v=") }; position != std::string::npos; position = r.body.find("v=", position + 1)) {
+            result.emplace_back(std::stoi(r.body.substr(position + 2)));
+        }
+    }
+    return result;
+}
+
+auto sequence(int n) -> std::vector<int>
+{
+    std::vector<int> result(static_cast<std::size_t>(n));
+    for (int i { 0 }; i < n; i++) {
+        result[static_cast<std::size_t>(i)] = i;
+    }
+    return result;
+}
+
+auto configuration(const server& db) -> influx_batch::configuration
+{
+    influx_batch::configuration config {};
+    config.host = db.url();
+    config.database = "test";
+    config.batch_size = 100;
+    config.batch_interval = 10s;
+    config.queue_size = 1000;
+    return config;
+}
+
+void batch_size(server& db)
+{
+    influx_batch link { configuration(db) };
+    // a batch takes everything collected until the writer wakes up, so each batch is sent before the next is written
+    write(link, 0, 100);
+    check(db.wait_for(100, 2s), "a full batch is sent without waiting for the interval");
+    write(link, 100, 100);
+    check(db.wait_for(200, 2s), "the next full batch is sent without waiting for the interval");
+    write(link, 200, 50);
+    std::this_thread::sleep_for(200ms);
+    check(db.records() == 200, "a partial batch waits for the interval");
+    link.stop();
+    link.wait();
+
+    const auto requests { db.accepted() };
+    check(requests.size() == 3, "the partial batch is sent on shutdown");
+    if (requests.size() == 3) {
+        check((lines(requests[0].body) == 100) && (lines(requests[1].body) == 100) && (lines(requests[2].body) == 50), "batches hold batch_size records");
+    }
+    check(values(requests) == sequence(250), "all records arrive in order");
+    check(requests.front().target == "/write?db=test&precision=ns", "the target names the database and precision");
+    db.clear();
+}
+
+void batch_interval(server& db)
+{
+    auto config { configuration(db) };
+    config.batch_interval = 200ms;
+    influx_batch link { config };
+    const auto start { std::chrono::steady_clock::now() };
+    write(link, 0, 10);
+    check(db.wait_for(10, 2s), "a partial batch is sent after the interval");
+    check((std::chrono::steady_clock::now() - start) < 1s, "a partial batch does not wait much longer than the interval");
+    const auto requests { db.accepted() };
+    check((requests.size() == 1) && (lines(requests.front().body) == 10), "the interval batch holds all records");
+    link.stop();
+    link.wait();
+    db.clear();
+}
+
+void gzip_and_authorization(server& db)
+{
+    auto config { configuration(db) };
+    config.gzip = true;
+    config.login.username = "user";
+    config.login.password = "secret";
+    influx_batch link { config };
+    write(link, 0, 100);
+    check(db.wait_for(100, 2s), "the compressed batch is sent");
+    link.stop();
+    link.wait();
+
+    const auto requests { db.accepted() };
+    check(!requests.empty() && (requests.front().encoding == "gzip"), "the body is marked as gzip");
+    check(values(requests) == sequence(100), "the body decompresses to all records");
+    check(!requests.empty() && (requests.front().authorization == "Basic dXNlcjpzZWNyZXQ="), "the credentials are sent as basic auth header");
+    check(!requests.empty() && (requests.front().target.find("secret") == std::string::npos), "the credentials are not part of the target");
+    db.clear();
+}
+
+void spill_and_replay(server& db, const std::filesystem::path& spill_file)
+{
+    auto config { configuration(db) };
+    config.batch_size = 10;
+    config.batch_interval = 50ms;
+    config.queue_size = 20;
+    config.spill_file = spill_file.string();
+
+    db.set_status(503);
+    {
+        influx_batch link { config };
+        for (int i { 0 }; i < 10; i++) {
+            write(link, i * 10, 10);
+            std::this_thread::sleep_for(100ms);
+        }
+        check(link.statistics().spilled > 0, "batches beyond the queue size are spilled");
+        db.set_status(204);
+        check(db.wait_for(100, 5s), "the queued and spilled batches are replayed");
+        link.stop();
+        link.wait();
+    }
+    check(values(db.accepted()) == sequence(100), "the queued batches are replayed before the spilled ones, in order");
+    check(!std::filesystem::exists(spill_file), "the spill file is removed after the replay");
+    db.clear();
+
+    // batches left on shutdown are stored and replayed by the next run
+    db.set_status(503);
+    {
+        influx_batch link { config };
+        for (int i { 0 }; i < 5; i++) {
+            write(link, i * 10, 10);
+            std::this_thread::sleep_for(100ms);
+        }
+        link.stop();
+        link.wait();
+    }
+    check(std::filesystem::exists(spill_file), "unsent batches are stored on shutdown");
+    db.set_status(204);
+    {
+        influx_batch link { config };
+        check(db.wait_for(50, 5s), "the stored batches are replayed after a restart");
+        link.stop();
+        link.wait();
+    }
+    check(values(db.accepted()) == sequence(50), "the stored batches are replayed in order");
+    db.clear();
+}
+} // namespace
+
+auto main() -> int
+{
+    const std::filesystem::path spill_file { std::filesystem::temp_directory_path() / "influx-batch-test.spill" };
+    std::filesystem::remove(spill_file);
+
+    server db {};
+    batch_size(db);
+    batch_interval(db);
+    gzip_and_authorization(db);
+    spill_and_replay(db, spill_file);
+
+    std::filesystem::remove(spill_file);
+
+    if (failures > 0) {
+        std::cerr << failures << " checks failed\n";
+        return 1;
+    }
+    std::cout << "All checks passed\n";
+    return 0;
+}